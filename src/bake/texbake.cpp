@@ -0,0 +1,52 @@
+#include "render/mip_chain.h"
+#include "render/texture_file.h"
+#include "stb_image/stb_image.h"
+
+#include <cstdint>
+#include <algorithm>
+#include <cstdlib>
+#include <iostream>
+#include <string>
+
+// Offline half of the texture pipeline: decodes a source image once at build
+// time, expands it to RGBA8, builds its mip chain and writes a .ktex file the
+// game maps at startup.
+//
+//   texbake input.png output.ktex [--levels N]
+int main(int argc, char** argv) {
+  if (argc < 3) {
+    std::cerr << "usage: texbake input.png output.ktex [--levels N]\n";
+    return 1;
+  }
+  std::string input = argv[1];
+  std::string output = argv[2];
+  size_t max_levels = SIZE_MAX;
+  for (int i = 3; i < argc; i++) {
+    std::string arg = argv[i];
+    if (arg == "--levels" && i + 1 < argc) {
+      max_levels = std::max<size_t>(1, std::strtoull(argv[++i], nullptr, 10));
+    } else {
+      std::cerr << "Unknown argument \"" << arg << "\"\n";
+      return 1;
+    }
+  }
+
+  int width;
+  int height;
+  int num_color_channels;
+  unsigned char* data = stbi_load(input.c_str(), &width, &height, &num_color_channels, 4);
+  if (!data) {
+    std::cerr << "Failed to load " << input << ": " << stbi_failure_reason() << "\n";
+    return 1;
+  }
+  MipChain mips = MipChain::build((const uint32_t*)data, width, height, max_levels);
+  stbi_image_free(data);
+
+  if (!TextureFile::write(mips, output)) {
+    std::cerr << "Failed to write " << output << "\n";
+    return 1;
+  }
+  std::cout << input << " -> " << output << ": " << width << "x" << height << ", "
+            << mips.num_levels() << " levels\n";
+  return 0;
+}
@@ -0,0 +1,91 @@
+#include "bench.h"
+
+#include <algorithm>
+#include <cmath>
+#include <iomanip>
+#include <thread>
+
+Bench::Runner::Runner(const Config& config) :
+                      config{config} {
+}
+
+bool Bench::Runner::selected(const std::string& name) const {
+  return config.filter.empty() || name.find(config.filter) != std::string::npos;
+}
+
+void Bench::Runner::add(const std::string& name, uint64_t items, uint64_t iterations,
+                        std::vector<double>& sample_ns) {
+  std::sort(sample_ns.begin(), sample_ns.end());
+  size_t n = sample_ns.size();
+  double sum = 0.0;
+  for (double ns : sample_ns)
+    sum += ns;
+  double mean = sum / n;
+  double squares = 0.0;
+  for (double ns : sample_ns)
+    squares += (ns - mean) * (ns - mean);
+
+  Result result{};
+  result.name = name;
+  result.items = items;
+  result.iterations_per_sample = iterations;
+  result.samples = n;
+  result.min_ns = sample_ns.front();
+  result.max_ns = sample_ns.back();
+  result.median_ns = n % 2 ? sample_ns[n / 2] : (sample_ns[n / 2 - 1] + sample_ns[n / 2]) / 2.0;
+  result.mean_ns = mean;
+  result.stddev_ns = n > 1 ? std::sqrt(squares / (n - 1)) : 0.0;
+  result.p95_ns = sample_ns[std::min(n - 1, (size_t)std::ceil(0.95 * n) - 1)];
+  results.push_back(result);
+}
+
+const std::vector<Bench::Result>& Bench::Runner::get_results() const {
+  return results;
+}
+
+void Bench::Runner::print_table(std::ostream& out) const {
+  out << std::left << std::setw(32) << "benchmark" << std::right
+      << std::setw(14) << "median ns" << std::setw(14) << "min ns" << std::setw(14) << "p95 ns"
+      << std::setw(10) << "stddev" << std::setw(14) << "ns/item" << "\n";
+  out << std::fixed << std::setprecision(1);
+  for (const Result& r : results) {
+    out << std::left << std::setw(32) << r.name << std::right
+        << std::setw(14) << r.median_ns << std::setw(14) << r.min_ns << std::setw(14) << r.p95_ns
+        << std::setw(9) << (r.median_ns > 0.0 ? 100.0 * r.stddev_ns / r.mean_ns : 0.0) << "%"
+        << std::setw(14) << std::setprecision(3) << r.median_ns / r.items << std::setprecision(1) << "\n";
+  }
+  out.unsetf(std::ios::floatfield);
+}
+
+void Bench::Runner::write_json(std::ostream& out) const {
+  out << "{\n  \"context\": {";
+#if defined(__clang__)
+  out << "\"compiler\": \"clang " << __clang_version__ << "\"";
+#elif defined(__GNUC__)
+  out << "\"compiler\": \"gcc " << __VERSION__ << "\"";
+#else
+  out << "\"compiler\": \"unknown\"";
+#endif
+#ifdef NDEBUG
+  out << ", \"assertions\": false";
+#else
+  out << ", \"assertions\": true";
+#endif
+  out << ", \"hardware_threads\": " << std::thread::hardware_concurrency()
+      << ", \"samples\": " << config.samples
+      << ", \"sample_seconds\": " << config.sample_seconds << "},\n";
+  out << "  \"benchmarks\": [\n";
+  out << std::fixed << std::setprecision(3);
+  for (size_t i = 0; i < results.size(); i++) {
+    const Result& r = results[i];
+    out << "    {\"name\": \"" << r.name << "\", \"items\": " << r.items
+        << ", \"iterations_per_sample\": " << r.iterations_per_sample << ", \"samples\": " << r.samples
+        << ", \"median_ns\": " << r.median_ns << ", \"mean_ns\": " << r.mean_ns
+        << ", \"stddev_ns\": " << r.stddev_ns << ", \"min_ns\": " << r.min_ns
+        << ", \"p95_ns\": " << r.p95_ns << ", \"max_ns\": " << r.max_ns
+        << ", \"ns_per_item\": " << r.median_ns / r.items << "}"
+        << (i + 1 < results.size() ? "," : "") << "\n";
+  }
+  out << "  ]\n}\n";
+  out.unsetf(std::ios::floatfield);
+}
@@ -0,0 +1,91 @@
+#pragma once
+#include <algorithm>
+#include <chrono>
+#include <cstddef>
+#include <cstdint>
+#include <ostream>
+#include <string>
+#include <vector>
+
+// Minimal microbenchmark harness. Each benchmark is warmed up, then timed
+// as a number of samples of a fixed iteration count, picked during warmup
+// so one sample takes about Config::sample_seconds. Reported times are per
+// iteration; with items set, also per item (per kart, per query...).
+namespace Bench {
+  struct Config {
+    double warmup_seconds = 0.2;
+    double sample_seconds = 0.02;
+    size_t samples = 30;
+    // Only benchmarks whose name contains this run.
+    std::string filter{};
+  };
+
+  struct Result {
+    std::string name;
+    // Work items one iteration processes.
+    uint64_t items;
+    uint64_t iterations_per_sample;
+    size_t samples;
+    // Nanoseconds per iteration over the samples.
+    double min_ns;
+    double median_ns;
+    double mean_ns;
+    double stddev_ns;
+    double p95_ns;
+    double max_ns;
+  };
+
+  // Stops the compiler from optimizing away value or the work behind it.
+  template<typename T>
+  inline void keep(const T& value) {
+    asm volatile("" : : "r,m"(value) : "memory");
+  }
+
+  class Runner {
+    private:
+      Config config;
+      std::vector<Result> results;
+
+      bool selected(const std::string& name) const;
+      void add(const std::string& name, uint64_t items, uint64_t iterations,
+               std::vector<double>& sample_ns);
+
+    public:
+      explicit Runner(const Config& config);
+
+      // Times body(), which does one iteration of items work items.
+      template<typename F>
+      void run(const std::string& name, uint64_t items, F&& body) {
+        if (!selected(name))
+          return;
+        using Clock = std::chrono::steady_clock;
+        auto seconds_since = [](Clock::time_point start) {
+          return std::chrono::duration<double>(Clock::now() - start).count();
+        };
+
+        uint64_t warmup_iterations = 0;
+        auto warmup_start = Clock::now();
+        do {
+          body();
+          warmup_iterations++;
+        } while (seconds_since(warmup_start) < config.warmup_seconds);
+        double seconds_per_iteration = seconds_since(warmup_start) / warmup_iterations;
+        uint64_t iterations = std::max<uint64_t>(1, (uint64_t)(config.sample_seconds / seconds_per_iteration));
+
+        std::vector<double> sample_ns(config.samples);
+        for (double& ns : sample_ns) {
+          auto start = Clock::now();
+          for (uint64_t i = 0; i < iterations; i++)
+            body();
+          ns = seconds_since(start) * 1e9 / iterations;
+        }
+        add(name, items, iterations, sample_ns);
+      }
+
+      const std::vector<Result>& get_results() const;
+      void print_table(std::ostream& out) const;
+      // {"context": {...}, "benchmarks": [...]}, one benchmark per line and
+      // in run order, so runs from two commits diff line by line.
+      void write_json(std::ostream& out) const;
+  };
+}
@@ -0,0 +1,207 @@
+#include "bench/bench.h"
+#include "render/camera.h"
+#include "render/sprite_batch.h"
+#include "sim/kart_physics.h"
+#include "sim/simulation.h"
+#include "sim/track_map.h"
+#include "stb_image/stb_image.h"
+#include "glm/mat4x4.hpp"
+#include "glm/ext/matrix_transform.hpp"
+#include "glm/ext/matrix_clip_space.hpp"
+
+#include <cstdint>
+#include <cstdlib>
+#include <fstream>
+#include <iostream>
+#include <iterator>
+#include <random>
+#include <string>
+#include <vector>
+
+// Microbenchmarks for the engine's hot paths, with fixed seeds and inputs
+// so runs on different commits measure the same work.
+//
+//   kart_bench [--json out.json] [--filter NAME] [--samples N] [--assets DIR]
+//
+// Run it from the build or source directory so src/assets resolves, or
+// point --assets at the directory holding course.png.
+namespace {
+  const uint64_t SEED = 1;
+
+  void bench_camera(Bench::Runner& runner) {
+    Camera camera{glm::vec3(0.f, 0.02f, 0.f)};
+    runner.run("camera/update", 1, [&] {
+      camera.turn_left(1.f);
+      camera.update();
+      Bench::keep(camera);
+    });
+    runner.run("camera/get_view_matrix", 1, [&] {
+      Bench::keep(camera.get_view_matrix());
+    });
+    runner.run("camera/look_along", 1, [&] {
+      Bench::keep(Camera::look_along(glm::vec3(0.1f, 0.02f, 0.3f), glm::vec3(0.6f, -0.1f, -0.8f)));
+    });
+  }
+
+  // Composed the way Renderer::render does it each frame.
+  void bench_mvp(Bench::Runner& runner) {
+    Camera camera = Camera::look_along(glm::vec3(0.1f, 0.02f, 0.3f), glm::vec3(0.6f, -0.1f, -0.8f));
+    float y_translate = -0.01f;
+    runner.run("render/mvp", 1, [&] {
+      Bench::keep(y_translate);
+      glm::mat4 model = glm::translate(glm::mat4(1.f), glm::vec3(0.f, y_translate, -0.3f));
+      model = glm::rotate(model, glm::radians(90.f), glm::vec3(1.f, 0.f, 0.f));
+      glm::mat4 projection = glm::perspective(glm::radians(45.f), 1280.f / 720.f, 0.01f, 100.f);
+      glm::mat4 mvp = projection * camera.get_view_matrix() * model;
+      Bench::keep(mvp);
+    });
+  }
+
+  // Decodes from memory so disk and page cache don't show up in the time.
+  void bench_decode(Bench::Runner& runner, const std::string& png_path) {
+    std::ifstream file{png_path, std::ios::binary};
+    std::vector<unsigned char> png{std::istreambuf_iterator<char>(file), std::istreambuf_iterator<char>()};
+    int width = 0;
+    int height = 0;
+    int channels = 0;
+    if (png.empty() || !stbi_info_from_memory(png.data(), (int)png.size(), &width, &height, &channels)) {
+      std::cerr << "Skipping image/stbi_load: can't read " << png_path << "\n";
+      return;
+    }
+    runner.run("image/stbi_load course.png", (uint64_t)width * height, [&] {
+      unsigned char* pixels = stbi_load_from_memory(png.data(), (int)png.size(), &width, &height, &channels, 4);
+      Bench::keep(pixels);
+      stbi_image_free(pixels);
+    });
+  }
+
+  // Random points over the course, the same ones every run.
+  void random_positions(size_t count, std::vector<float>& xs, std::vector<float>& zs) {
+    std::mt19937 rng{SEED};
+    std::uniform_real_distribution<float> coord{-0.5f, 0.5f};
+    xs.resize(count);
+    zs.resize(count);
+    for (size_t i = 0; i < count; i++) {
+      xs[i] = coord(rng);
+      zs[i] = coord(rng) - 0.3f;
+    }
+  }
+
+  void bench_track(Bench::Runner& runner, const TrackMap& track) {
+    const size_t count = 4096;
+    std::vector<float> xs;
+    std::vector<float> zs;
+    random_positions(count, xs, zs);
+    std::vector<Surface> surfaces(count);
+    runner.run("track/surface_at", count, [&] {
+      for (size_t i = 0; i < count; i++)
+        surfaces[i] = track.surface_at(xs[i], zs[i]);
+      Bench::keep(surfaces.data());
+    });
+    runner.run("track/surfaces_at", count, [&] {
+      track.surfaces_at(xs.data(), zs.data(), count, surfaces.data());
+      Bench::keep(surfaces.data());
+    });
+  }
+
+  // One second of simulation from the same start every iteration, so the
+  // karts don't wander into a different mix of surfaces as the run goes on.
+  void bench_karts(Bench::Runner& runner, const TrackMap* track, size_t num_karts) {
+    const int ticks = 60;
+    KartPhysics initial;
+    std::mt19937 rng{SEED};
+    std::uniform_real_distribution<float> coord{-0.5f, 0.5f};
+    std::uniform_real_distribution<float> heading{-1.f, 1.f};
+    while (initial.size() < num_karts) {
+      float x = coord(rng);
+      float z = coord(rng) - 0.3f;
+      if (!track || track->surface_at(x, z) == Surface::ROAD) {
+        size_t kart = initial.add_kart(x, z, heading(rng), heading(rng));
+        uint32_t pattern = (uint32_t)(kart * 2654435761u);
+        initial.set_controls(kart, 1.f, (float)(pattern % 3) - 1.f, (pattern >> 3) % 4 == 0);
+      }
+    }
+    std::string name = "kart/step x" + std::to_string(num_karts);
+    runner.run(name, (uint64_t)num_karts * ticks, [&] {
+      KartPhysics physics = initial;
+      for (int t = 0; t < ticks; t++)
+        physics.step(Simulation::TICK_SECONDS, track);
+      Bench::keep(physics.get_karts().x.data());
+    });
+  }
+
+  void bench_sprites(Bench::Runner& runner, size_t num_sprites) {
+    Camera camera = Camera::look_along(glm::vec3(0.f, 0.02f, 0.2f), glm::vec3(0.f, -0.1f, -1.f));
+    std::mt19937 rng{SEED};
+    std::uniform_real_distribution<float> coord{-0.5f, 0.5f};
+    std::uniform_int_distribution<int> page{1, 4};
+    std::vector<SpriteBatch::Sprite> sprites(num_sprites);
+    for (SpriteBatch::Sprite& sprite : sprites) {
+      sprite.position = glm::vec3(coord(rng), 0.f, coord(rng));
+      sprite.size = glm::vec2(0.004f, 0.003f);
+      sprite.texture = (GLuint)page(rng);
+    }
+    std::vector<SpriteBatch::SortItem> order;
+    order.reserve(num_sprites);
+    std::vector<SpriteBatch::Vertex> vertices(num_sprites * 4);
+    const SpriteBatch::SortMode modes[] = {SpriteBatch::SortMode::BACK_TO_FRONT, SpriteBatch::SortMode::TEXTURE};
+    const char* mode_names[] = {"back_to_front", "texture"};
+    for (int m = 0; m < 2; m++) {
+      std::string name = std::string("sprite/batch ") + mode_names[m] + " x" + std::to_string(num_sprites);
+      runner.run(name, num_sprites, [&] {
+        SpriteBatch::sort(sprites, camera, modes[m], order);
+        SpriteBatch::write_vertices(sprites, order, camera, vertices.data());
+        Bench::keep(vertices.data());
+      });
+    }
+  }
+}
+
+int main(int argc, char** argv) {
+  Bench::Config config{};
+  std::string json_path{};
+  std::string assets = "src/assets";
+  for (int i = 1; i < argc; i++) {
+    std::string arg = argv[i];
+    if (arg == "--json" && i + 1 < argc) {
+      json_path = argv[++i];
+    } else if (arg == "--filter" && i + 1 < argc) {
+      config.filter = argv[++i];
+    } else if (arg == "--samples" && i + 1 < argc) {
+      config.samples = std::max<size_t>(1, std::strtoull(argv[++i], nullptr, 10));
+    } else if (arg == "--assets" && i + 1 < argc) {
+      assets = argv[++i];
+    } else {
+      std::cerr << "Unknown argument \"" << arg << "\"\n";
+      return 1;
+    }
+  }
+
+  TrackMap track;
+  bool have_track = track.load(assets + "/course.png");
+  if (have_track)
+    track.load_surfaces(assets + "/course_surfaces.txt");
+  else
+    std::cerr << "No track at " << assets << "; kart benchmarks run on open road\n";
+
+  Bench::Runner runner{config};
+  bench_camera(runner);
+  bench_mvp(runner);
+  bench_decode(runner, assets + "/course.png");
+  if (have_track)
+    bench_track(runner, track);
+  bench_karts(runner, have_track ? &track : nullptr, 1024);
+  bench_karts(runner, have_track ? &track : nullptr, 16384);
+  bench_sprites(runner, 1000);
+  runner.print_table(std::cout);
+
+  if (!json_path.empty()) {
+    std::ofstream out{json_path};
+    runner.write_json(out);
+    if (!out) {
+      std::cerr << "Failed to write " << json_path << "\n";
+      return 1;
+    }
+  }
+  return 0;
+}
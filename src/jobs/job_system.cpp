@@ -0,0 +1,313 @@
+#include "job_system.h"
+#include "memory/frame_arena.h"
+#include "profiler/profiler.h"
+
+#include <algorithm>
+#include <array>
+#include <cstdint>
+#include <cstdio>
+#include <new>
+
+namespace {
+  const size_t CACHE_LINE = 64;
+  // Rounds of looking for work, yielding in between, before a worker goes
+  // to sleep. Work tends to arrive in bursts (one parallel_for a frame), so
+  // a short spin saves a wakeup between the chunks of a burst.
+  const int IDLE_SPINS = 64;
+
+  // Bounded Chase-Lev deque of jobs, in the formulation of Lê et al.,
+  // "Correct and Efficient Work-Stealing for Weak Memory Models" (2013),
+  // with the fences folded into sequentially consistent accesses. The
+  // owner pushes and pops at the bottom without contention except over
+  // the last item; thieves take from the top with a compare-and-swap.
+  template<typename T>
+  class WorkDeque {
+    static constexpr int64_t CAPACITY = 4096;
+
+    alignas(CACHE_LINE) std::atomic<int64_t> top{0};
+    alignas(CACHE_LINE) std::atomic<int64_t> bottom{0};
+    std::array<std::atomic<T*>, CAPACITY> slots{};
+
+    public:
+      // Owner only. Returns false if full.
+      bool push(T* item) {
+        int64_t b = bottom.load(std::memory_order_relaxed);
+        int64_t t = top.load(std::memory_order_acquire);
+        if (b - t >= CAPACITY)
+          return false;
+        slots[b & (CAPACITY - 1)].store(item, std::memory_order_relaxed);
+        bottom.store(b + 1, std::memory_order_release);
+        return true;
+      }
+
+      // Owner only. The most recently pushed item, or nullptr.
+      T* pop() {
+        int64_t b = bottom.load(std::memory_order_relaxed) - 1;
+        bottom.store(b, std::memory_order_seq_cst);
+        int64_t t = top.load(std::memory_order_seq_cst);
+        if (t > b) {
+          bottom.store(b + 1, std::memory_order_relaxed);
+          return nullptr;
+        }
+        T* item = slots[b & (CAPACITY - 1)].load(std::memory_order_relaxed);
+        if (t == b) {
+          // Last item: race any thief for it.
+          if (!top.compare_exchange_strong(t, t + 1, std::memory_order_seq_cst, std::memory_order_relaxed))
+            item = nullptr;
+          bottom.store(b + 1, std::memory_order_relaxed);
+        }
+        return item;
+      }
+
+      // Any thread. The oldest item, or nullptr if empty or another thread
+      // got there first.
+      T* steal() {
+        int64_t t = top.load(std::memory_order_seq_cst);
+        int64_t b = bottom.load(std::memory_order_seq_cst);
+        if (t >= b)
+          return nullptr;
+        T* item = slots[t & (CAPACITY - 1)].load(std::memory_order_relaxed);
+        if (!top.compare_exchange_strong(t, t + 1, std::memory_order_seq_cst, std::memory_order_relaxed))
+          return nullptr;
+        return item;
+      }
+  };
+
+  // Which JobSystem's worker the current thread is, if any.
+  thread_local const JobSystem* tls_owner = nullptr;
+  thread_local void* tls_worker = nullptr;
+}
+
+struct JobSystem::Job {
+  std::function<void()> task;
+  Job* parent;
+  // The job itself plus each child that hasn't finished.
+  std::atomic<int> unfinished;
+  // parallel_for's jobs: placed in an arena rather than on the heap, and
+  // running part of a range instead of task.
+  bool in_arena = false;
+  Range* range = nullptr;
+  size_t begin = 0;
+  size_t end = 0;
+};
+
+// One parallel_for call. Any thread splitting the range claims job slots
+// from the preallocated array.
+struct JobSystem::Range {
+  const void* body;
+  RangeBody call;
+  size_t grain;
+  Job* root;
+  Job* jobs;
+  std::atomic<size_t> used;
+};
+
+struct JobSystem::Worker {
+  WorkDeque<Job> deque;
+  size_t index;
+};
+
+JobSystem::JobSystem(int num_threads) :
+                     injected_head{0},
+                     queued{0},
+                     sleeping{0},
+                     stopping{false} {
+  if (num_threads <= 0)
+    num_threads = std::max(1u, std::thread::hardware_concurrency());
+  // Every worker exists before any thread starts, since they steal from
+  // each other.
+  for (int i = 1; i < num_threads; i++) {
+    workers.push_back(std::make_unique<Worker>());
+    workers.back()->index = workers.size() - 1;
+  }
+  for (size_t i = 0; i < workers.size(); i++)
+    threads.emplace_back(&JobSystem::worker_loop, this, i);
+}
+
+JobSystem::~JobSystem() {
+  stopping.store(true);
+  {
+    std::lock_guard<std::mutex> lock{sleep_mutex};
+  }
+  wake.notify_all();
+  for (auto& thread : threads)
+    thread.join();
+}
+
+JobSystem::Worker* JobSystem::current_worker() const {
+  return tls_owner == this ? (Worker*)tls_worker : nullptr;
+}
+
+void JobSystem::worker_loop(size_t index) {
+  Worker* self = workers[index].get();
+  char name[32];
+  std::snprintf(name, sizeof(name), "worker %zu", index);
+  Profiler::set_thread_name(name);
+  tls_owner = this;
+  tls_worker = self;
+  int idle = 0;
+  while (!stopping.load(std::memory_order_acquire)) {
+    if (Job* job = find_job(self)) {
+      execute(job);
+      idle = 0;
+      continue;
+    }
+    if (++idle < IDLE_SPINS) {
+      std::this_thread::yield();
+      continue;
+    }
+    std::unique_lock<std::mutex> lock{sleep_mutex};
+    sleeping.fetch_add(1);
+    wake.wait(lock, [&] { return stopping.load() || queued.load() > 0; });
+    sleeping.fetch_sub(1);
+    idle = 0;
+  }
+}
+
+JobSystem::Job* JobSystem::find_job(Worker* self) {
+  if (self) {
+    if (Job* job = self->deque.pop()) {
+      queued.fetch_sub(1, std::memory_order_relaxed);
+      return job;
+    }
+  }
+  if (queued.load(std::memory_order_relaxed) <= 0)
+    return nullptr;
+  {
+    std::lock_guard<std::mutex> lock{injected_mutex};
+    if (injected_head < injected.size()) {
+      Job* job = injected[injected_head++];
+      if (injected_head == injected.size()) {
+        injected.clear();
+        injected_head = 0;
+      }
+      queued.fetch_sub(1, std::memory_order_relaxed);
+      return job;
+    }
+  }
+  // Start with the next worker along, so thieves spread over victims
+  // instead of all hitting the first one.
+  size_t start = self ? self->index + 1 : 0;
+  for (size_t i = 0; i < workers.size(); i++) {
+    Worker* victim = workers[(start + i) % workers.size()].get();
+    if (victim == self)
+      continue;
+    if (Job* job = victim->deque.steal()) {
+      queued.fetch_sub(1, std::memory_order_relaxed);
+      return job;
+    }
+  }
+  return nullptr;
+}
+
+void JobSystem::execute(Job* job) {
+  Profiler::Scope zone{"job"};
+  if (job->range)
+    split_range(job->range, job->begin, job->end);
+  else if (job->task)
+    job->task();
+  finish(job);
+}
+
+void JobSystem::finish(Job* job) {
+  // Read before the decrement: once it reaches zero a waiter may free job.
+  Job* parent = job->parent;
+  if (job->unfinished.fetch_sub(1, std::memory_order_acq_rel) != 1)
+    return;
+  if (parent) {
+    if (!job->in_arena)
+      delete job;
+    finish(parent);
+  }
+}
+
+JobSystem::Job* JobSystem::create(std::function<void()> task, Job* parent) {
+  Job* job = new Job{std::move(task), parent, {1}};
+  if (parent)
+    parent->unfinished.fetch_add(1, std::memory_order_relaxed);
+  return job;
+}
+
+void JobSystem::submit(Job* job) {
+  Worker* self = current_worker();
+  if (self) {
+    if (!self->deque.push(job)) {
+      // Deque full: this thread is far ahead of the others, so just run it.
+      execute(job);
+      return;
+    }
+  } else if (workers.empty()) {
+    execute(job);
+    return;
+  } else {
+    std::lock_guard<std::mutex> lock{injected_mutex};
+    injected.push_back(job);
+  }
+  queued.fetch_add(1);
+  if (sleeping.load() > 0) {
+    std::lock_guard<std::mutex> lock{sleep_mutex};
+    wake.notify_one();
+  }
+}
+
+JobSystem::Job* JobSystem::run(std::function<void()> task, Job* parent) {
+  Job* job = create(std::move(task), parent);
+  submit(job);
+  return job;
+}
+
+void JobSystem::wait(Job* job) {
+  Worker* self = current_worker();
+  while (job->unfinished.load(std::memory_order_acquire) > 0) {
+    if (Job* other = find_job(self))
+      execute(other);
+    else
+      std::this_thread::yield();
+  }
+  if (!job->in_arena)
+    delete job;
+}
+
+void JobSystem::split_range(Range* range, size_t begin, size_t end) {
+  // Hand off the upper half until one chunk is left, so a thief takes a
+  // large range and splits it further on its own thread.
+  while (end - begin > range->grain) {
+    size_t mid = begin + (end - begin) / 2;
+    Job* job = &range->jobs[range->used.fetch_add(1, std::memory_order_relaxed)];
+    new (job) Job{{}, range->root, {1}, true, range, mid, end};
+    range->root->unfinished.fetch_add(1, std::memory_order_relaxed);
+    submit(job);
+    end = mid;
+  }
+  range->call(range->body, begin, end);
+}
+
+void JobSystem::parallel_for(size_t count, size_t grain, const void* body, RangeBody call) {
+  if (count == 0)
+    return;
+  if (grain == 0)
+    grain = std::max<size_t>(1, count / (get_num_threads() * 4));
+  if (count <= grain || workers.empty()) {
+    call(body, 0, count);
+    return;
+  }
+
+  // Halving only stops once a piece is at most grain, so every piece ends
+  // up over grain / 2 and there are fewer than 2 * count / grain of them;
+  // each split makes one job, so that bounds the jobs too.
+  FrameArena& arena = FrameArena::for_thread();
+  FrameArena::Scope scope{arena};
+  size_t max_jobs = 2 * count / grain + 1;
+  Job* root = new (arena.allocate_array<Job>(1)) Job{{}, nullptr, {1}, true};
+  Range range{body, call, grain, root, arena.allocate_array<Job>(max_jobs), {0}};
+  split_range(&range, 0, count);
+  finish(root);
+  wait(root);
+  for (size_t i = 0; i < range.used.load(std::memory_order_relaxed); i++)
+    range.jobs[i].~Job();
+  root->~Job();
+}
+
+int JobSystem::get_num_threads() const {
+  return (int)workers.size() + 1;
+}
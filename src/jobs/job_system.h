@@ -0,0 +1,95 @@
+#pragma once
+#include <atomic>
+#include <condition_variable>
+#include <cstddef>
+#include <functional>
+#include <memory>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+// Work-stealing scheduler shared by everything in the engine that wants
+// more than one core: physics, the software renderer and asset decoding.
+//
+// Each worker thread owns a deque. Jobs a worker spawns go on the bottom
+// of its own deque and it takes work from the bottom too, so it mostly
+// runs what it just made while that is still in cache; idle workers steal
+// from the top of someone else's, which is where the biggest, oldest
+// pieces of work sit. Threads that aren't workers (the main thread, the
+// simulation thread) submit through a shared queue and help run jobs
+// while they wait().
+//
+// A job may have a parent. A parent doesn't count as finished until its
+// own task and every child's have, so waiting on the parent waits on the
+// whole tree. Jobs with a parent are freed when they finish; a job without
+// one must be passed to wait() exactly once, which frees it.
+class JobSystem {
+  public:
+    struct Job;
+
+  private:
+    struct Worker;
+    struct Range;
+    using RangeBody = void (*)(const void* body, size_t begin, size_t end);
+
+    std::vector<std::unique_ptr<Worker>> workers;
+    std::vector<std::thread> threads;
+    // Jobs submitted from threads that aren't workers, oldest from
+    // injected_head on. A vector rather than a deque so its storage is
+    // reused instead of reallocated as jobs pass through.
+    std::mutex injected_mutex;
+    std::vector<Job*> injected;
+    size_t injected_head;
+    // Jobs sitting in any queue, so idle workers know whether to sleep.
+    std::atomic<int> queued;
+    std::atomic<int> sleeping;
+    std::mutex sleep_mutex;
+    std::condition_variable wake;
+    std::atomic<bool> stopping;
+
+    void worker_loop(size_t index);
+    // The calling thread's worker, or nullptr if it isn't one of ours.
+    Worker* current_worker() const;
+    Job* find_job(Worker* self);
+    void execute(Job* job);
+    void finish(Job* job);
+    void split_range(Range* range, size_t begin, size_t end);
+    void parallel_for(size_t count, size_t grain, const void* body, RangeBody call);
+
+  public:
+    // num_threads counts the threads that call wait(); 0 uses every
+    // hardware thread. One thread means no workers: submit() runs each job
+    // on the calling thread before it returns.
+    explicit JobSystem(int num_threads = 0);
+    // Every job must have been waited on.
+    ~JobSystem();
+    JobSystem(const JobSystem&) = delete;
+    JobSystem& operator=(const JobSystem&) = delete;
+
+    // Makes a job that runs task once submitted. A parent must not have
+    // finished yet: create children before submitting it or from inside
+    // one of its running jobs. task may be empty, for a job that only
+    // groups its children.
+    Job* create(std::function<void()> task, Job* parent = nullptr);
+    void submit(Job* job);
+    // create() and submit().
+    Job* run(std::function<void()> task, Job* parent = nullptr);
+    // Runs other jobs on this thread until job and all its children have
+    // finished, then frees job.
+    void wait(Job* job);
+
+    // Calls body(begin, end) over [0, count) in chunks of about grain items,
+    // spread over every thread, and returns once all have run. grain 0
+    // picks a few chunks per thread. The calling thread takes part.
+    //
+    // Its jobs live in the calling thread's FrameArena and body is called
+    // through a plain pointer, so a parallel_for allocates nothing.
+    template<typename F>
+    void parallel_for(size_t count, size_t grain, const F& body) {
+      parallel_for(count, grain, &body, [](const void* f, size_t begin, size_t end) {
+        (*(const F*)f)(begin, end);
+      });
+    }
+
+    int get_num_threads() const;
+};
@@ -1,89 +1,564 @@
 #include "render/render.h"
 #include "render/camera.h"
+#include "render/asset_manager.h"
+#include "render/gl_state.h"
+#include "render/sprite_batch.h"
+#include "render/texture_atlas.h"
+#include "jobs/job_system.h"
+#include "memory/allocation_counter.h"
+#include "memory/frame_arena.h"
+#include "profiler/frame_stats.h"
+#include "profiler/profiler.h"
+#include "sim/input.h"
+#include "sim/input_queue.h"
+#include "sim/input_recording.h"
+#include "sim/kart_physics.h"
+#include "sim/simulation.h"
+#include "sim/simulation_thread.h"
+#include "sim/track_map.h"
+#include "render/soft_render.h"
 #include "imgui/imgui.h"
 #include "imgui/backends/imgui_impl_glfw.h"
 #include "imgui/backends/imgui_impl_opengl3.h"
 #include "glad/glad.h"
+#include "glm/ext/matrix_transform.hpp"
 
 #include <GLFW/glfw3.h>
 
 #include <iostream>
 #include <string>
 #include <chrono>
-#include <bitset>
-
-static Camera cam{};
-class Input {
-  private:
-    std::bitset<16> actions{};
-  public:
-    enum Action {
-      MOVE_FORWARD,
-      MOVE_BACKWARD,
-      TURN_LEFT,
-      TURN_RIGHT
-    };
-    void set_action(Action a) {
-      actions.set(a);
-    }
-    void unset_action(Action a) {
-      actions.reset(a);
-    }
-    bool is_action_set(Action a) {
-      return actions.test(a);
-    }
-} input;
+#include <fstream>
+#include <cstdint>
+#include <cstdlib>
+#include <memory>
+#include <random>
+#include <algorithm>
+#include <cmath>
+#include <numeric>
+#include <vector>
 
-static void key_callback(GLFWwindow* window, int key, int scancode, int action, int mods) {
-  if (key == GLFW_KEY_W) {
-    if (action == GLFW_PRESS)
-      input.set_action(Input::Action::MOVE_FORWARD);
-    else if (action == GLFW_RELEASE)
-      input.unset_action(Input::Action::MOVE_FORWARD);
-  }
-  if (key == GLFW_KEY_S) {
-    if (action == GLFW_PRESS)
-      input.set_action(Input::Action::MOVE_BACKWARD);
-    else if (action == GLFW_RELEASE)
-      input.unset_action(Input::Action::MOVE_BACKWARD);
-  }
-  if (key == GLFW_KEY_A) {
-    if (action == GLFW_PRESS)
-      input.set_action(Input::Action::TURN_LEFT);
-    else if (action == GLFW_RELEASE)
-      input.unset_action(Input::Action::TURN_LEFT);
-  }
-  if (key == GLFW_KEY_D) {
-    if (action == GLFW_PRESS)
-      input.set_action(Input::Action::TURN_RIGHT);
-    else if (action == GLFW_RELEASE)
-      input.unset_action(Input::Action::TURN_RIGHT);
-  }
+static Simulation sim{};
+static InputQueue input_queue{};
+static TrackMap track{};
+static InputRecording recording{};
 
+static void key_callback(GLFWwindow* window, int key, int scancode, int action, int mods) {
   if (key == GLFW_KEY_ESCAPE && action == GLFW_PRESS)
     glfwSetWindowShouldClose(window, GLFW_TRUE);
+  if (action != GLFW_PRESS && action != GLFW_RELEASE)
+    return;
+
+  Input::Action mapped;
+  switch (key) {
+    case GLFW_KEY_W: mapped = Input::Action::MOVE_FORWARD; break;
+    case GLFW_KEY_S: mapped = Input::Action::MOVE_BACKWARD; break;
+    case GLFW_KEY_A: mapped = Input::Action::TURN_LEFT; break;
+    case GLFW_KEY_D: mapped = Input::Action::TURN_RIGHT; break;
+    case GLFW_KEY_SPACE: mapped = Input::Action::DRIFT; break;
+    default: return;
+  }
+  // GLFW calls this from glfwPollEvents(), so now() is the poll time;
+  // GLFW doesn't tell us when the key actually went down.
+  input_queue.push(InputQueue::Event{InputQueue::now(), mapped, action == GLFW_PRESS});
+}
+
+// Height of the course plane in the GL renderer.
+static const float COURSE_HEIGHT = -0.01f;
+
+// One billboard per kart, at its position between the snapshot's previous
+// and current tick. The player's kart is tinted so it stands out.
+static void add_kart_sprites(SpriteBatch& sprites, const Snapshot& snapshot, float alpha) {
+  sprites.clear();
+  for (size_t i = 0; i < snapshot.x.size(); i++) {
+    SpriteBatch::Sprite sprite{};
+    sprite.position = glm::vec3{snapshot.prev_x[i] + (snapshot.x[i] - snapshot.prev_x[i]) * alpha, COURSE_HEIGHT,
+                                snapshot.prev_z[i] + (snapshot.z[i] - snapshot.prev_z[i]) * alpha};
+    sprite.size = glm::vec2{0.004f, 0.003f};
+    sprite.color = i == Simulation::PLAYER_KART ? 0xff2020e0 : 0xffe0a020;
+    sprites.add(sprite);
+  }
+}
+
+// Trees on the grass and cones on the sand beside the road, scattered from
+// a fixed seed so every run sees the same course. Each prop is two crossed
+// quads so it has some width from every side. A kind gives up after a
+// bounded number of tries, e.g. on a course with no grass.
+static void add_track_props(PropInstances& props, const TrackMap& track_map, const AtlasBuilder::Atlas& atlas) {
+  struct Kind {
+    const char* image;
+    Surface surface;
+    float height;
+    size_t count;
+  };
+  const Kind kinds[] = {
+    {"src/assets/props/tree.png", Surface::GRASS, 0.012f, 300},
+    {"src/assets/props/cone.png", Surface::OFF_TRACK, 0.003f, 150},
+  };
+  std::mt19937 rng{7};
+  std::uniform_real_distribution<float> coord{-0.5f, 0.5f};
+  std::uniform_real_distribution<float> yaw{0.f, glm::radians(180.f)};
+  for (const Kind& kind : kinds) {
+    const AtlasBuilder::Region* region = atlas.find(kind.image);
+    if (!region)
+      continue;
+    float width = kind.height * region->width / region->height;
+    size_t placed = 0;
+    for (size_t tries = 0; placed < kind.count && tries < kind.count * 50; tries++) {
+      float x = coord(rng);
+      float z = coord(rng) - 0.3f;
+      if (track_map.surface_at(x, z) != kind.surface)
+        continue;
+      float angle = yaw(rng);
+      for (int quad = 0; quad < 2; quad++) {
+        glm::mat4 transform = glm::translate(glm::mat4(1.f), glm::vec3(x, COURSE_HEIGHT, z));
+        transform = glm::rotate(transform, angle + quad * glm::radians(90.f), glm::vec3(0.f, 1.f, 0.f));
+        transform = glm::scale(transform, glm::vec3(width, kind.height, 1.f));
+        props.add(PropInstances::Instance{transform, region->uv_rect});
+      }
+      placed++;
+    }
+  }
 }
 
 static void error_callback(int error, const char* description) {
   std::cerr << "Error: " << description << "\n";
 }
 
-static void process_input(float ticks) {
-  if (input.is_action_set(Input::Action::MOVE_FORWARD)) {
-    cam.move_forward(ticks);
+// Drive forward in a slow weave so headless runs exercise both movement
+// and turning without anyone at the keyboard, drifting through the last
+// part of each turn.
+static Input headless_input(uint64_t tick) {
+  Input in{};
+  in.set_action(Input::Action::MOVE_FORWARD);
+  if ((tick / 120) % 2 == 0)
+    in.set_action(Input::Action::TURN_LEFT);
+  else
+    in.set_action(Input::Action::TURN_RIGHT);
+  if (tick % 120 >= 80)
+    in.set_action(Input::Action::DRIFT);
+  return in;
+}
+
+// Prefers the course baked by texbake and falls back to decoding the PNG,
+// e.g. when running from the source tree instead of the build directory.
+static std::string course_texture_path() {
+  std::ifstream baked("src/assets/course.ktex");
+  return baked.good() ? "src/assets/course.ktex" : "src/assets/course.png";
+}
+
+struct Options {
+  bool headless = false;
+  uint64_t headless_ticks = 100000;
+  bool soft_render = false;
+  uint64_t soft_render_frames = 600;
+  int threads = 0;
+  uint64_t karts = 0;
+  uint64_t kart_ticks = 600;
+  bool mipmaps = true;
+  bool verify = false;
+  uint64_t verify_ticks = 3600;
+  bool texel_stats = false;
+  uint64_t texel_stats_frames = 600;
+  bool gl_bench = false;
+  uint64_t gl_bench_frames = 600;
+  std::string dump_path{};
+  std::string record_path{};
+  std::string replay_path{};
+  std::string trace_path{};
+};
+
+// Consumes the value following a flag if there is one, otherwise keeps the default.
+static uint64_t parse_count(int argc, char** argv, int& i, uint64_t fallback) {
+  if (i + 1 < argc && argv[i + 1][0] != '-')
+    return std::strtoull(argv[++i], nullptr, 10);
+  return fallback;
+}
+
+static Options parse_options(int argc, char** argv) {
+  Options opts{};
+  for (int i = 1; i < argc; i++) {
+    std::string arg = argv[i];
+    if (arg == "--headless") {
+      opts.headless = true;
+      opts.headless_ticks = parse_count(argc, argv, i, opts.headless_ticks);
+    } else if (arg == "--soft-render") {
+      opts.soft_render = true;
+      opts.soft_render_frames = parse_count(argc, argv, i, opts.soft_render_frames);
+    } else if (arg == "--threads") {
+      opts.threads = (int)parse_count(argc, argv, i, 0);
+    } else if (arg == "--karts") {
+      opts.karts = parse_count(argc, argv, i, 10000);
+    } else if (arg == "--kart-ticks") {
+      opts.kart_ticks = parse_count(argc, argv, i, opts.kart_ticks);
+    } else if (arg == "--verify-determinism") {
+      opts.verify = true;
+      opts.verify_ticks = parse_count(argc, argv, i, opts.verify_ticks);
+    } else if (arg == "--gl-bench") {
+      opts.gl_bench = true;
+      opts.gl_bench_frames = parse_count(argc, argv, i, opts.gl_bench_frames);
+    } else if (arg == "--no-mipmaps") {
+      opts.mipmaps = false;
+    } else if (arg == "--texel-stats") {
+      opts.texel_stats = true;
+      opts.texel_stats_frames = parse_count(argc, argv, i, opts.texel_stats_frames);
+    } else if (arg == "--dump" && i + 1 < argc) {
+      opts.dump_path = argv[++i];
+    } else if (arg == "--record" && i + 1 < argc) {
+      opts.record_path = argv[++i];
+    } else if (arg == "--replay" && i + 1 < argc) {
+      opts.replay_path = argv[++i];
+    } else if (arg == "--trace" && i + 1 < argc) {
+      opts.trace_path = argv[++i];
+    } else {
+      std::cerr << "Unknown argument \"" << arg << "\"\n";
+    }
+  }
+  return opts;
+}
+
+static bool save_recording(const std::string& path) {
+  recording.set_final_checksum(sim.checksum());
+  if (!recording.save(path)) {
+    std::cerr << "Failed to write " << path << "\n";
+    return false;
+  }
+  std::cout << "recorded " << recording.get_num_ticks() << " ticks in "
+            << recording.get_runs().size() << " runs to " << path << "\n";
+  return true;
+}
+
+static int run_headless(uint64_t num_ticks, const TrackMap* course_track, const std::string& record_path) {
+  auto t_start = std::chrono::steady_clock::now();
+  for (uint64_t i = 0; i < num_ticks; i++) {
+    Input in = headless_input(sim.get_tick());
+    if (!record_path.empty())
+      recording.record(in);
+    sim.step(in);
+  }
+  auto t_end = std::chrono::steady_clock::now();
+
+  double seconds = std::chrono::duration<double>(t_end - t_start).count();
+  glm::vec3 pos = sim.get_camera().get_position();
+  std::cout << "ticks: " << num_ticks << "\n";
+  std::cout << "seconds: " << seconds << "\n";
+  std::cout << "ticks/s: " << (seconds > 0.0 ? num_ticks / seconds : 0.0) << "\n";
+  std::cout << "final position: " << pos.x << " " << pos.y << " " << pos.z << "\n";
+  if (course_track)
+    std::cout << "final surface: " << surface_name(course_track->surface_at(pos.x, pos.z)) << "\n";
+  std::cout << "checksum: " << std::hex << sim.checksum() << std::dec << "\n";
+  if (!record_path.empty())
+    return save_recording(record_path) ? 0 : 1;
+  return 0;
+}
+
+// Feeds a recording through the simulation as fast as it will go and checks
+// the end state against the one recorded.
+static int run_replay(const std::string& path) {
+  InputRecording replay{};
+  if (!replay.load(path))
+    return 1;
+  InputRecording::Playback playback{replay};
+  auto t_start = std::chrono::steady_clock::now();
+  while (!playback.done())
+    sim.step(playback.next());
+  auto t_end = std::chrono::steady_clock::now();
+
+  double seconds = std::chrono::duration<double>(t_end - t_start).count();
+  uint64_t num_ticks = replay.get_num_ticks();
+  uint64_t checksum = sim.checksum();
+  std::cout << "runs: " << replay.get_runs().size() << "\n";
+  std::cout << "ticks: " << num_ticks << " (" << num_ticks * Simulation::TICK_SECONDS << " s of play)\n";
+  std::cout << "seconds: " << seconds << "\n";
+  std::cout << "ticks/s: " << (seconds > 0.0 ? num_ticks / seconds : 0.0) << "\n";
+  std::cout << "checksum: " << std::hex << checksum << std::dec << "\n";
+  if (replay.get_final_checksum() == 0)
+    return 0;
+  if (checksum != replay.get_final_checksum()) {
+    std::cerr << "Replay diverged from the recording, which ended at "
+              << std::hex << replay.get_final_checksum() << std::dec << "\n";
+    return 1;
+  }
+  std::cout << "matches recording\n";
+  return 0;
+}
+
+// Runs the scripted input through two fresh simulations and compares their
+// state hashes after every tick. The final hash is printed so runs from
+// different builds or machines can be compared too.
+static int run_verify_determinism(uint64_t num_ticks, const TrackMap* course_track) {
+  Simulation runs[2]{};
+  runs[0].set_track(course_track);
+  runs[1].set_track(course_track);
+  for (uint64_t t = 0; t < num_ticks; t++) {
+    Input in = headless_input(t);
+    runs[0].step(in);
+    runs[1].step(in);
+    uint64_t a = runs[0].checksum();
+    uint64_t b = runs[1].checksum();
+    if (a != b) {
+      std::cerr << "Runs diverged at tick " << t << ": "
+                << std::hex << a << " != " << b << std::dec << "\n";
+      return 1;
+    }
+  }
+  std::cout << "ticks: " << num_ticks << "\n";
+  std::cout << "checksum: " << std::hex << runs[0].checksum() << std::dec << "\n";
+  return 0;
+}
+
+// Steps num_karts AI-free karts on the course for num_ticks and reports
+// throughput. Karts start on random road texels with full throttle and
+// steer in a pattern that changes every second, so they spread out, leave
+// the road and hit walls. Without a track they start anywhere in the
+// course square and drive on open road.
+static int run_kart_bench(uint64_t num_karts, uint64_t num_ticks, const TrackMap* course_track, JobSystem& jobs) {
+  KartPhysics physics;
+  std::mt19937 rng{1};
+  std::uniform_real_distribution<float> coord{-0.5f, 0.5f};
+  std::uniform_real_distribution<float> heading{-1.f, 1.f};
+  while (physics.size() < num_karts) {
+    float x = coord(rng);
+    float z = coord(rng) - 0.3f;
+    if (!course_track || course_track->surface_at(x, z) == Surface::ROAD)
+      physics.add_kart(x, z, heading(rng), heading(rng));
   }
-  if (input.is_action_set(Input::Action::MOVE_BACKWARD)) {
-    cam.move_backward(ticks);
+
+  KartPhysics::Karts& karts = physics.get_karts();
+  auto t_start = std::chrono::steady_clock::now();
+  for (uint64_t t = 0; t < num_ticks; t++) {
+    // Stand-in for AI drivers, spread over the job system the same way.
+    jobs.parallel_for(physics.size(), KartPhysics::PARALLEL_CHUNK, [&](size_t begin, size_t end) {
+      for (size_t i = begin; i < end; i++) {
+        uint32_t pattern = (uint32_t)(i * 2654435761u) ^ (uint32_t)(t / 60);
+        karts.throttle[i] = 1.f;
+        karts.steer[i] = (float)(pattern % 3) - 1.f;
+        karts.drift[i] = (pattern >> 3) % 4 == 0;
+      }
+    });
+    physics.step(Simulation::TICK_SECONDS, course_track, &jobs);
+  }
+  auto t_end = std::chrono::steady_clock::now();
+
+  double seconds = std::chrono::duration<double>(t_end - t_start).count();
+  double kart_ticks = (double)num_karts * num_ticks;
+  uint64_t on_surface[(size_t)Surface::COUNT] = {};
+  for (Surface surface : karts.surface)
+    on_surface[(size_t)surface]++;
+  std::cout << "karts: " << num_karts << "\n";
+  std::cout << "threads: " << jobs.get_num_threads() << "\n";
+  std::cout << "ticks: " << num_ticks << "\n";
+  std::cout << "seconds: " << seconds << "\n";
+  std::cout << "ticks/s: " << (seconds > 0.0 ? num_ticks / seconds : 0.0) << "\n";
+  std::cout << "ns/kart/tick: " << (kart_ticks > 0.0 ? seconds * 1e9 / kart_ticks : 0.0) << "\n";
+  for (size_t s = 0; s < (size_t)Surface::COUNT; s++)
+    std::cout << "on " << surface_name((Surface)s) << ": " << on_surface[s] << "\n";
+  return 0;
+}
+
+// Renders one frame per sim tick on the CPU and reports fill rate.
+static int run_soft_render(uint64_t num_frames, JobSystem& jobs, bool mipmaps, const std::string& dump_path) {
+  auto t_load = std::chrono::steady_clock::now();
+  std::string course_path = course_texture_path();
+  SoftRenderer::Texture course = SoftRenderer::load_texture(course_path);
+  double load_ms = std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - t_load).count();
+  SoftRenderer::Framebuffer fb{1280, 720};
+  SoftRenderer::Kernel kernel = SoftRenderer::best_kernel();
+  SoftRenderer::BandRenderer band_renderer{jobs};
+  SoftRenderer::Projection projection{};
+  projection.mipmaps = mipmaps;
+
+  FrameArena& frame_arena = FrameArena::for_thread();
+  // The first frame sizes buffers and arenas; count heap allocations from
+  // the second on, which should be none.
+  uint64_t allocations_start = AllocationCounter::thread_count();
+  auto t_start = std::chrono::steady_clock::now();
+  for (uint64_t i = 0; i < num_frames; i++) {
+    if (i == 1)
+      allocations_start = AllocationCounter::thread_count();
+    sim.step(headless_input(sim.get_tick()));
+    band_renderer.render(sim.get_camera(), course, fb, {}, projection, kernel);
+    frame_arena.reset();
   }
-  if (input.is_action_set(Input::Action::TURN_LEFT)) {
-    cam.turn_left(ticks);
+  auto t_end = std::chrono::steady_clock::now();
+  uint64_t allocations = AllocationCounter::thread_count() - allocations_start;
+
+  double seconds = std::chrono::duration<double>(t_end - t_start).count();
+  double pixels = (double)num_frames * fb.width * fb.height;
+  std::cout << "texture: " << course_path << " (" << load_ms << " ms)\n";
+  std::cout << "kernel: " << SoftRenderer::kernel_name(kernel) << "\n";
+  std::cout << "mipmaps: " << (mipmaps ? "on" : "off") << "\n";
+  std::cout << "threads: " << band_renderer.get_num_threads() << "\n";
+  std::cout << "frames: " << num_frames << "\n";
+  std::cout << "seconds: " << seconds << "\n";
+  std::cout << "frames/s: " << (seconds > 0.0 ? num_frames / seconds : 0.0) << "\n";
+  std::cout << "Mpixels/s: " << (seconds > 0.0 ? pixels / seconds / 1e6 : 0.0) << "\n";
+  std::cout << "heap allocations/frame: "
+            << (num_frames > 1 ? (double)allocations / (num_frames - 1) : 0.0) << "\n";
+  if (!dump_path.empty())
+    SoftRenderer::write_ppm(fb, dump_path);
+  return 0;
+}
+
+// Average per-frame texture traffic along the scripted path, with and
+// without mipmaps, to show how much less memory the far rows touch.
+static int run_texel_stats(uint64_t num_frames) {
+  SoftRenderer::Texture course = SoftRenderer::load_texture(course_texture_path());
+  SoftRenderer::Projection base_only{};
+  base_only.mipmaps = false;
+  SoftRenderer::Projection mipmapped{};
+  SoftRenderer::TexelStats totals[2]{};
+
+  for (uint64_t i = 0; i < num_frames; i++) {
+    sim.step(headless_input(sim.get_tick()));
+    const SoftRenderer::Projection* projections[2] = {&base_only, &mipmapped};
+    for (int p = 0; p < 2; p++) {
+      SoftRenderer::TexelStats stats = SoftRenderer::measure_texels(sim.get_camera(), course, 1280, 720,
+                                                                    {}, *projections[p]);
+      totals[p].texels_fetched += stats.texels_fetched;
+      totals[p].distinct_texels += stats.distinct_texels;
+      totals[p].distinct_cache_lines += stats.distinct_cache_lines;
+    }
   }
-  if (input.is_action_set(Input::Action::TURN_RIGHT)) {
-    cam.turn_right(ticks);
+
+  uint64_t frames = std::max<uint64_t>(num_frames, 1);
+  const char* names[2] = {"base level", "mipmapped"};
+  std::cout << "frames: " << num_frames << "\n";
+  for (int p = 0; p < 2; p++) {
+    std::cout << names[p] << ": "
+              << totals[p].texels_fetched / frames << " fetches, "
+              << totals[p].distinct_texels / frames << " distinct texels, "
+              << totals[p].distinct_cache_lines / frames << " cache lines ("
+              << totals[p].distinct_cache_lines * SoftRenderer::CACHE_LINE / frames / 1024 << " KiB) per frame\n";
   }
+  return 0;
 }
 
-int main() {
+// Writes the profiler's zones out once main returns, after the job system
+// and simulation thread have stopped and finished their last zones.
+struct TraceWriter {
+  std::string path;
+
+  ~TraceWriter() {
+    if (path.empty())
+      return;
+    if (Profiler::write_chrome_trace(path))
+      std::cout << "trace written to " << path << "\n";
+    else
+      std::cerr << "Failed to write " << path << "\n";
+  }
+};
+
+// Nearest-rank percentile of sorted values.
+static double percentile(const std::vector<double>& sorted, double p) {
+  size_t rank = (size_t)std::ceil(p * sorted.size());
+  return sorted[std::min(sorted.size() - 1, rank > 0 ? rank - 1 : 0)];
+}
+
+// Renders num_frames frames of the scripted drive, one simulation tick per
+// frame so the camera path doesn't depend on frame rate, and reports frame
+// times. Meant for an invisible window with vsync off; under Mesa's
+// llvmpipe it gives a whole-frame number without a display or GPU.
+static int run_gl_bench(uint64_t num_frames, GLFWwindow* window, Renderer::Course& course,
+                        Renderer::Scene& scene, AssetManager& assets,
+                        AssetManager::TextureHandle course_texture, SpriteBatch& sprites) {
+  // Frames that settle buffer sizes, shader compiles and driver caches
+  // before timing starts.
+  const uint64_t WARMUP_FRAMES = 30;
+  assets.finish();
+  course.texture = assets.get_texture(course_texture);
+  if (assets.get_state(course_texture) != AssetManager::State::READY)
+    std::cerr << "Course texture failed to load; drawing the placeholder\n";
+
+  Snapshot snapshot{};
+  std::vector<double> frame_ms{};
+  frame_ms.reserve(num_frames);
+  for (uint64_t i = 0; i < WARMUP_FRAMES + num_frames; i++) {
+    auto t_frame = std::chrono::steady_clock::now();
+    if (scene.frame_stats) {
+      scene.frame_stats->end_frame();
+      if (i == WARMUP_FRAMES)
+        scene.frame_stats->clear();
+    }
+    {
+      Profiler::Scope zone{"input"};
+      glfwPollEvents();
+    }
+    sim.step(headless_input(sim.get_tick()));
+    sim.write_snapshot(snapshot, 0.0);
+    add_kart_sprites(sprites, snapshot, 1.f);
+    Camera cam = snapshot.interpolated_camera(1.f);
+    Renderer::render(cam, course, scene);
+    {
+      Profiler::Scope zone{"swap"};
+      glfwSwapBuffers(window);
+    }
+    if (i >= WARMUP_FRAMES)
+      frame_ms.push_back(std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - t_frame).count());
+  }
+  if (scene.frame_stats)
+    scene.frame_stats->end_frame();
+
+  std::vector<double> sorted = frame_ms;
+  std::sort(sorted.begin(), sorted.end());
+  double total_ms = std::accumulate(frame_ms.begin(), frame_ms.end(), 0.0);
+  int width = 0;
+  int height = 0;
+  glfwGetFramebufferSize(window, &width, &height);
+  std::cout << "renderer: " << glGetString(GL_RENDERER) << "\n";
+  std::cout << "resolution: " << width << "x" << height << "\n";
+  std::cout << "frames: " << num_frames << " (after " << WARMUP_FRAMES << " warm-up)\n";
+  if (sorted.empty())
+    return 0;
+  std::cout << "seconds: " << total_ms / 1000.0 << "\n";
+  std::cout << "frames/s: " << (total_ms > 0.0 ? num_frames * 1000.0 / total_ms : 0.0) << "\n";
+  std::cout << "frame ms mean: " << total_ms / num_frames << "\n";
+  std::cout << "frame ms p50: " << percentile(sorted, 0.50) << "\n";
+  std::cout << "frame ms p95: " << percentile(sorted, 0.95) << "\n";
+  std::cout << "frame ms p99: " << percentile(sorted, 0.99) << "\n";
+  std::cout << "frame ms max: " << sorted.back() << "\n";
+  if (scene.frame_stats) {
+    const FrameStats& stats = *scene.frame_stats;
+    std::cout << "median ms per zone over the last " << stats.size() << " frames:\n";
+    for (size_t t = 0; t < stats.get_num_tracked(); t++)
+      std::cout << "  " << stats.get_tracked_name(t) << ": " << stats.summarize((int)t).p50 << "\n";
+  }
+  return 0;
+}
+
+int main(int argc, char** argv) {
+  Options opts = parse_options(argc, argv);
+  // Keep a whole run rather than the last few seconds. Naming a thread
+  // creates its ring, so this has to come first.
+  if (!opts.trace_path.empty())
+    Profiler::set_zones_per_thread(1 << 20);
+  Profiler::set_thread_name("main");
+  TraceWriter trace{opts.trace_path};
+  // An unloaded TrackMap is wall everywhere, so without one the karts
+  // drive on open road instead.
+  const TrackMap* course_track = nullptr;
+  if (track.load("src/assets/course.png")) {
+    track.load_surfaces("src/assets/course_surfaces.txt");
+    course_track = &track;
+  } else {
+    std::cerr << "No track map; karts drive on open road\n";
+  }
+  JobSystem jobs{opts.threads};
+  sim.set_track(course_track);
+  sim.set_job_system(&jobs);
+  if (opts.karts)
+    return run_kart_bench(opts.karts, opts.kart_ticks, course_track, jobs);
+  if (opts.verify)
+    return run_verify_determinism(opts.verify_ticks, course_track);
+  if (opts.texel_stats)
+    return run_texel_stats(opts.texel_stats_frames);
+  if (opts.soft_render)
+    return run_soft_render(opts.soft_render_frames, jobs, opts.mipmaps, opts.dump_path);
+  if (!opts.replay_path.empty())
+    return run_replay(opts.replay_path);
+  if (opts.headless)
+    return run_headless(opts.headless_ticks, course_track, opts.record_path);
+
   glfwSetErrorCallback(error_callback);
   if (!glfwInit()) {
     std::cerr << "Failed to initialize GLFW\n";
@@ -91,16 +566,24 @@ int main() {
   glfwWindowHint(GLFW_CONTEXT_VERSION_MAJOR, 3);
   glfwWindowHint(GLFW_CONTEXT_VERSION_MINOR, 3);
   glfwWindowHint(GLFW_OPENGL_PROFILE, GLFW_OPENGL_CORE_PROFILE);
+  // The benchmark still needs a default framebuffer to swap, but nobody
+  // watches it, so it needn't show up on screen.
+  if (opts.gl_bench)
+    glfwWindowHint(GLFW_VISIBLE, GLFW_FALSE);
 
   const int screen_width = 1280;
   const int screen_height = 720;
   GLFWwindow* window = glfwCreateWindow(screen_width, screen_height, "Kart RPG", NULL, NULL);
-  if (!window)
+  if (!window) {
     std::cerr << "Failed to create window\n";
+    glfwTerminate();
+    return 1;
+  }
 
   glfwSetKeyCallback(window, key_callback);
   glfwMakeContextCurrent(window);
-  glfwSwapInterval(1);
+  // Unthrottled when benchmarking, so frame times are the real cost.
+  glfwSwapInterval(opts.gl_bench ? 0 : 1);
 
   bool err = gladLoadGL() == 0;
   if (err)
@@ -146,6 +629,7 @@ int main() {
   GLuint vert_shader = Renderer::compile_shader(vert_shader_source, "VERTEX");
   GLuint frag_shader = Renderer::compile_shader(frag_shader_source, "FRAGMENT");
   GLuint shader_program = Renderer::build_shader_program(vert_shader, frag_shader);
+  Renderer::CourseShader course_shader = Renderer::make_course_shader(shader_program);
   std::vector<Renderer::Attribute> attribs {
     {
       .name = "pos",
@@ -159,31 +643,103 @@ int main() {
     }
   };
 
-  Renderer::setup_shader_attributes(shader_program, attribs);
-  Renderer::load_texture("src/assets/course.png");
+  Renderer::setup_shader_attributes(course_shader.program, attribs);
+  auto assets = std::make_unique<AssetManager>(jobs);
+  AssetManager::TextureHandle course_texture = assets->load_texture(course_texture_path());
+  Renderer::Course course{course_shader, vao, assets->get_texture(course_texture)};
+  auto sprites = std::make_unique<SpriteBatch>();
+  Renderer::Scene scene{};
+  scene.sprites = sprites.get();
+  // The props share one small atlas page. Without a track map there is
+  // nowhere sensible to put them.
+  GLuint prop_texture = 0;
+  std::unique_ptr<PropInstances> props{};
+  if (course_track) {
+    AtlasBuilder prop_atlas_builder{256};
+    prop_atlas_builder.add_file("src/assets/props/tree.png");
+    prop_atlas_builder.add_file("src/assets/props/cone.png");
+    AtlasBuilder::Atlas prop_atlas = prop_atlas_builder.build();
+    if (!prop_atlas.pages.empty()) {
+      prop_texture = Renderer::upload_texture(prop_atlas.pages[0], Renderer::TextureFilter::TRILINEAR);
+      props = std::make_unique<PropInstances>(prop_texture);
+      add_track_props(*props, *course_track, prop_atlas);
+      scene.props.push_back(props.get());
+    }
+  }
+  scene.assets = assets.get();
+  auto frame_stats = std::make_unique<FrameStats>(std::initializer_list<const char*>{
+      "input", "upload", "render", "imgui", "swap", "sim", "job",
+      Renderer::PASS_NAMES[Renderer::PASS_COURSE], Renderer::PASS_NAMES[Renderer::PASS_PROPS],
+      Renderer::PASS_NAMES[Renderer::PASS_SPRITES], Renderer::PASS_NAMES[Renderer::PASS_IMGUI]});
+  scene.frame_stats = frame_stats.get();
+  auto gpu_timer = std::make_unique<GpuTimer>(Renderer::PASS_NAMES, Renderer::NUM_PASSES);
+  scene.gpu_timer = gpu_timer.get();
 
-  auto t_prev = std::chrono::high_resolution_clock::now();
-  while (!glfwWindowShouldClose(window)) {
-    auto t_now = std::chrono::high_resolution_clock::now();
-    float ticks = std::chrono::duration_cast<std::chrono::duration<float>>(t_now - t_prev).count();
-    t_prev = t_now;
-    glfwPollEvents();
-    process_input(ticks);
-    cam.update();
-    Renderer::render(cam, shader_program);
-    glfwSwapBuffers(window);
+  int result = 0;
+  if (opts.gl_bench) {
+    result = run_gl_bench(opts.gl_bench_frames, window, course, scene, *assets, course_texture, *sprites);
+  } else {
+    // The simulation ticks on its own thread; this one polls input, draws
+    // the newest snapshot and swaps, so GL submission of one frame overlaps
+    // the simulation of the next.
+    SimulationThread sim_thread{sim, input_queue, opts.record_path.empty() ? nullptr : &recording};
+    sim_thread.start();
+    FrameArena& frame_arena = FrameArena::for_thread();
+    while (!glfwWindowShouldClose(window)) {
+      // Closes the previous frame, whose zones have all ended by now.
+      frame_stats->end_frame();
+      uint64_t allocations_before = AllocationCounter::thread_count();
+      Profiler::Scope frame_zone{"frame"};
+      {
+        Profiler::Scope zone{"input"};
+        glfwPollEvents();
+      }
+      const Snapshot& snapshot = sim_thread.latest_snapshot();
+      // Draw one tick behind, blending towards the newest tick as real time
+      // catches up with it.
+      float alpha = (float)((InputQueue::now() - snapshot.time) / Simulation::TICK_SECONDS);
+      alpha = std::min(std::max(alpha, 0.f), 1.f);
+      Camera cam = snapshot.interpolated_camera(alpha);
+      add_kart_sprites(*sprites, snapshot, alpha);
+      {
+        Profiler::Scope zone{"upload"};
+        // Keep texture uploads to a slice of the 16 ms frame.
+        assets->update(2.0);
+      }
+      course.texture = assets->get_texture(course_texture);
+      Renderer::render(cam, course, scene);
+      {
+        Profiler::Scope zone{"swap"};
+        glfwSwapBuffers(window);
+      }
+      frame_arena.reset();
+      scene.frame_allocations = AllocationCounter::thread_count() - allocations_before;
+      scene.frame_arena_peak = frame_arena.peak_bytes();
+    }
+    sim_thread.stop();
+    // The simulation thread has been joined, so its state and the
+    // recording it wrote are safe to read from here.
+    if (!opts.record_path.empty() && !save_recording(opts.record_path))
+      result = 1;
   }
 
-  glDeleteProgram(shader_program);
+  gpu_timer.reset();
+  sprites.reset();
+  props.reset();
+  if (prop_texture)
+    GLState::delete_texture(prop_texture);
+  assets.reset();
+  GLState::delete_program(shader_program);
   glDeleteShader(vert_shader);
   glDeleteShader(frag_shader);
-  glDeleteBuffers(1, &vbo);
-  glDeleteBuffers(1, &ebo);
-  glDeleteVertexArrays(1, &vao);
+  GLState::delete_buffer(vbo);
+  GLState::delete_buffer(ebo);
+  GLState::delete_vertex_array(vao);
   ImGui_ImplOpenGL3_Shutdown();
   ImGui_ImplGlfw_Shutdown();
   ImGui::DestroyContext();
   glfwDestroyWindow(window);
   glfwTerminate();
+  return result;
 }
 
@@ -0,0 +1,108 @@
+#include "allocation_counter.h"
+
+#include <algorithm>
+#include <cstdlib>
+#include <new>
+
+// Replacements for the global allocation functions. Being in the same
+// object file as thread_count() means the linker pulls them in whenever
+// anything reads the counter.
+
+namespace {
+  // Constant-initialized, so it is safe to touch from operator new during
+  // thread startup.
+  thread_local uint64_t allocations = 0;
+
+  void* allocate(size_t size) {
+    allocations++;
+    return std::malloc(size ? size : 1);
+  }
+
+  void* allocate_aligned(size_t size, std::align_val_t alignment) {
+    allocations++;
+    size_t align = (size_t)alignment;
+    // aligned_alloc wants the size to be a multiple of the alignment.
+    size_t rounded = (std::max<size_t>(size, 1) + align - 1) / align * align;
+    return std::aligned_alloc(align, rounded);
+  }
+}
+
+uint64_t AllocationCounter::thread_count() {
+  return allocations;
+}
+
+void* operator new(size_t size) {
+  if (void* p = allocate(size))
+    return p;
+  throw std::bad_alloc{};
+}
+
+void* operator new[](size_t size) {
+  return operator new(size);
+}
+
+void* operator new(size_t size, const std::nothrow_t&) noexcept {
+  return allocate(size);
+}
+
+void* operator new[](size_t size, const std::nothrow_t&) noexcept {
+  return allocate(size);
+}
+
+void* operator new(size_t size, std::align_val_t alignment) {
+  if (void* p = allocate_aligned(size, alignment))
+    return p;
+  throw std::bad_alloc{};
+}
+
+void* operator new[](size_t size, std::align_val_t alignment) {
+  return operator new(size, alignment);
+}
+
+void* operator new(size_t size, std::align_val_t alignment, const std::nothrow_t&) noexcept {
+  return allocate_aligned(size, alignment);
+}
+
+void* operator new[](size_t size, std::align_val_t alignment, const std::nothrow_t&) noexcept {
+  return allocate_aligned(size, alignment);
+}
+
+void operator delete(void* p) noexcept {
+  std::free(p);
+}
+
+void operator delete[](void* p) noexcept {
+  std::free(p);
+}
+
+void operator delete(void* p, size_t) noexcept {
+  std::free(p);
+}
+
+void operator delete[](void* p, size_t) noexcept {
+  std::free(p);
+}
+
+void operator delete(void* p, std::align_val_t) noexcept {
+  std::free(p);
+}
+
+void operator delete[](void* p, std::align_val_t) noexcept {
+  std::free(p);
+}
+
+void operator delete(void* p, size_t, std::align_val_t) noexcept {
+  std::free(p);
+}
+
+void operator delete[](void* p, size_t, std::align_val_t) noexcept {
+  std::free(p);
+}
+
+void operator delete(void* p, const std::nothrow_t&) noexcept {
+  std::free(p);
+}
+
+void operator delete[](void* p, const std::nothrow_t&) noexcept {
+  std::free(p);
+}
@@ -0,0 +1,13 @@
+#pragma once
+#include <cstdint>
+
+// Counts calls to the global operator new, per thread, by replacing it for
+// the whole program. Frame loops compare the count before and after a
+// frame to prove the steady state allocates nothing; any code that does
+// shows up as a non-zero delta in the overlay or the headless reports.
+//
+// Allocations made through malloc directly (ImGui, stb_image) aren't seen.
+namespace AllocationCounter {
+  // Heap allocations made by the calling thread since it started.
+  uint64_t thread_count();
+}
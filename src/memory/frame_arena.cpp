@@ -0,0 +1,95 @@
+#include "frame_arena.h"
+
+#include <algorithm>
+
+namespace {
+  size_t align_up(size_t value, size_t alignment) {
+    return (value + alignment - 1) & ~(alignment - 1);
+  }
+}
+
+FrameArena::Scope::Scope(FrameArena& arena) :
+                         arena{arena},
+                         marker{arena.mark()} {
+}
+
+FrameArena::Scope::~Scope() {
+  arena.rewind(marker);
+}
+
+FrameArena::FrameArena(size_t block_size) :
+                       block{0},
+                       offset{0},
+                       used{0},
+                       peak{0} {
+  blocks.push_back(Block{std::make_unique<unsigned char[]>(block_size), block_size});
+}
+
+void* FrameArena::allocate(size_t bytes, size_t alignment) {
+  while (true) {
+    Block& current = blocks[block];
+    uintptr_t base = (uintptr_t)current.data.get();
+    size_t start = align_up(base + offset, alignment) - base;
+    if (start + bytes <= current.size) {
+      used += start + bytes - offset;
+      offset = start + bytes;
+      peak = std::max(peak, used);
+      return current.data.get() + start;
+    }
+    // Spill into the next block, making one if this is the last. The
+    // leftover tail of this one counts as used, so peak reflects what a
+    // single block would have needed.
+    used += current.size - offset;
+    if (block + 1 == blocks.size()) {
+      size_t size = std::max(blocks[0].size, bytes + alignment);
+      blocks.push_back(Block{std::make_unique<unsigned char[]>(size), size});
+    }
+    block++;
+    offset = 0;
+  }
+}
+
+void FrameArena::reset() {
+  if (blocks.size() > 1) {
+    // Outgrew the arena: trade the spill blocks for one that fits a whole
+    // frame like this one.
+    size_t size = std::max(blocks[0].size, align_up(peak, alignof(std::max_align_t)));
+    blocks.clear();
+    blocks.push_back(Block{std::make_unique<unsigned char[]>(size), size});
+  }
+  block = 0;
+  offset = 0;
+  used = 0;
+}
+
+FrameArena::Marker FrameArena::mark() const {
+  return Marker{block, offset};
+}
+
+void FrameArena::rewind(const Marker& marker) {
+  used = marker.offset;
+  for (size_t i = 0; i < marker.block; i++)
+    used += blocks[i].size;
+  block = marker.block;
+  offset = marker.offset;
+}
+
+size_t FrameArena::bytes_used() const {
+  return used;
+}
+
+size_t FrameArena::peak_bytes() const {
+  return peak;
+}
+
+size_t FrameArena::capacity() const {
+  size_t total = 0;
+  for (const Block& b : blocks)
+    total += b.size;
+  return total;
+}
+
+FrameArena& FrameArena::for_thread() {
+  thread_local FrameArena arena{};
+  return arena;
+}
@@ -0,0 +1,126 @@
+#pragma once
+#include <cstddef>
+#include <cstdint>
+#include <memory>
+#include <vector>
+
+// Bump allocator for data that only lives for one frame: sprite lists,
+// collision query results, formatted UI strings. Allocating is a pointer
+// bump and freeing is a no-op; reset() at the end of the frame releases
+// everything at once. Each thread has its own (for_thread()), so there is
+// no locking.
+//
+// Memory is kept across resets. A frame that outgrows the arena spills into
+// extra blocks, and the next reset() replaces them with one block big
+// enough for the whole frame, so after the first few frames a steady-state
+// frame never touches the heap.
+class FrameArena {
+  public:
+    static constexpr size_t DEFAULT_BLOCK_SIZE = 256 * 1024;
+
+    // Position to rewind to; see Scope.
+    struct Marker {
+      size_t block;
+      size_t offset;
+    };
+
+    // Frees whatever was allocated from the arena during its lifetime. For
+    // code that can't wait for the end of the frame, such as jobs on worker
+    // threads, which have no frame of their own. Scopes must nest and must
+    // not span a reset().
+    class Scope {
+      private:
+        FrameArena& arena;
+        Marker marker;
+
+      public:
+        explicit Scope(FrameArena& arena);
+        ~Scope();
+        Scope(const Scope&) = delete;
+        Scope& operator=(const Scope&) = delete;
+    };
+
+  private:
+    struct Block {
+      std::unique_ptr<unsigned char[]> data;
+      size_t size;
+    };
+
+    std::vector<Block> blocks;
+    size_t block;
+    size_t offset;
+    // Bytes handed out since the last reset(), counting what is wasted at
+    // the end of blocks that spilled over.
+    size_t used;
+    size_t peak;
+
+  public:
+    explicit FrameArena(size_t block_size = DEFAULT_BLOCK_SIZE);
+    FrameArena(const FrameArena&) = delete;
+    FrameArena& operator=(const FrameArena&) = delete;
+
+    // alignment must be a power of two.
+    void* allocate(size_t bytes, size_t alignment = alignof(std::max_align_t));
+    template<typename T>
+    T* allocate_array(size_t count) {
+      return (T*)allocate(count * sizeof(T), alignof(T));
+    }
+
+    // Invalidates everything allocated since the last reset().
+    void reset();
+    Marker mark() const;
+    void rewind(const Marker& marker);
+
+    size_t bytes_used() const;
+    // Most bytes used between two resets.
+    size_t peak_bytes() const;
+    size_t capacity() const;
+
+    // The calling thread's arena, created on first use.
+    static FrameArena& for_thread();
+};
+
+// Lets standard containers allocate from a FrameArena. deallocate() does
+// nothing, so a container that grows leaves its old buffers behind until
+// the reset; reserve() up front where the size is known.
+template<typename T>
+class ArenaAllocator {
+  template<typename U>
+  friend class ArenaAllocator;
+
+  FrameArena* arena;
+
+  public:
+    using value_type = T;
+
+    ArenaAllocator() :
+                   arena{&FrameArena::for_thread()} {
+    }
+    explicit ArenaAllocator(FrameArena& arena) :
+                            arena{&arena} {
+    }
+    template<typename U>
+    ArenaAllocator(const ArenaAllocator<U>& other) :
+                   arena{other.arena} {
+    }
+
+    T* allocate(size_t n) {
+      return arena->allocate_array<T>(n);
+    }
+    void deallocate(T*, size_t) {
+    }
+
+    template<typename U>
+    bool operator==(const ArenaAllocator<U>& other) const {
+      return arena == other.arena;
+    }
+    template<typename U>
+    bool operator!=(const ArenaAllocator<U>& other) const {
+      return arena != other.arena;
+    }
+};
+
+// A vector whose storage comes from this thread's frame arena. It must not
+// outlive the frame.
+template<typename T>
+using FrameVector = std::vector<T, ArenaAllocator<T>>;
@@ -0,0 +1,188 @@
+#include "frame_stats.h"
+
+#include <algorithm>
+#include <cmath>
+#include <cstring>
+
+namespace {
+  float to_ms(int64_t ns) {
+    return (float)((double)ns / 1e6);
+  }
+
+  void copy_capture(const FrameStats::Capture& from, FrameStats::Capture& to) {
+    to.begin_ns = from.begin_ns;
+    to.end_ns = from.end_ns;
+    to.num_zones = from.num_zones;
+    std::copy(from.zones, from.zones + from.num_zones, to.zones);
+  }
+
+  // Nearest-rank percentile of the first n values, reordering them.
+  float percentile(float* values, size_t n, float p) {
+    size_t rank = (size_t)std::ceil(p * n);
+    size_t index = rank > 0 ? rank - 1 : 0;
+    std::nth_element(values, values + index, values + n);
+    return values[index];
+  }
+}
+
+FrameStats::FrameStats(std::initializer_list<const char*> tracked) :
+                       tracked{},
+                       num_tracked{0},
+                       frames{},
+                       next{0},
+                       count{0},
+                       frame_begin_ns{Profiler::now_ns()},
+                       added_ms{},
+                       missing{},
+                       current{},
+                       last{},
+                       slowest{},
+                       frozen{false} {
+  for (const char* name : tracked) {
+    if (num_tracked == MAX_TRACKED)
+      break;
+    this->tracked[num_tracked++] = name;
+  }
+}
+
+void FrameStats::end_frame() {
+  int64_t frame_end_ns = Profiler::now_ns();
+  current.begin_ns = frame_begin_ns;
+  current.end_ns = frame_end_ns;
+  current.num_zones = Profiler::collect(frame_begin_ns, frame_end_ns, current.zones, MAX_ZONES);
+  frame_begin_ns = frame_end_ns;
+
+  Frame& frame = frames[next];
+  frame.total_ms = to_ms(current.end_ns - current.begin_ns);
+  std::copy(added_ms, added_ms + MAX_TRACKED, frame.tracked_ms);
+  std::fill(added_ms, added_ms + MAX_TRACKED, 0.f);
+  std::copy(missing, missing + MAX_TRACKED, frame.tracked_missing);
+  std::fill(missing, missing + MAX_TRACKED, false);
+  // Each thread's zones come in the order they ended, so a zone's children
+  // all come before it, after its previous sibling. Summing durations by
+  // depth as they go by gives each zone's child time when it arrives.
+  int64_t child_ns[MAX_DEPTH + 1] = {};
+  uint32_t thread = UINT32_MAX;
+  for (size_t i = 0; i < current.num_zones; i++) {
+    const Profiler::Zone& zone = current.zones[i];
+    if (zone.thread != thread) {
+      thread = zone.thread;
+      std::fill(child_ns, child_ns + MAX_DEPTH + 1, 0);
+    }
+    uint32_t depth = std::min(zone.depth, MAX_DEPTH - 1);
+    int64_t duration = zone.end_ns - zone.begin_ns;
+    int64_t self = duration - child_ns[depth + 1];
+    child_ns[depth + 1] = 0;
+    child_ns[depth] += duration;
+    for (size_t t = 0; t < num_tracked; t++) {
+      if (std::strcmp(zone.name, tracked[t]) == 0) {
+        frame.tracked_ms[t] += to_ms(self);
+        break;
+      }
+    }
+  }
+  next = (next + 1) % HISTORY;
+  count = std::min(count + 1, HISTORY);
+
+  if (!frozen)
+    copy_capture(current, last);
+  if (current.end_ns - current.begin_ns > slowest.end_ns - slowest.begin_ns)
+    copy_capture(current, slowest);
+}
+
+void FrameStats::add_time(const char* name, float ms) {
+  for (size_t t = 0; t < num_tracked; t++) {
+    if (std::strcmp(name, tracked[t]) == 0) {
+      added_ms[t] += ms;
+      return;
+    }
+  }
+}
+
+void FrameStats::mark_missing(const char* name) {
+  for (size_t t = 0; t < num_tracked; t++) {
+    if (std::strcmp(name, tracked[t]) == 0) {
+      missing[t] = true;
+      return;
+    }
+  }
+}
+
+size_t FrameStats::size() const {
+  return count;
+}
+
+const FrameStats::Frame& FrameStats::frame(size_t index) const {
+  size_t oldest = count < HISTORY ? 0 : next;
+  return frames[(oldest + index) % HISTORY];
+}
+
+size_t FrameStats::slowest_frame() const {
+  size_t slowest_index = 0;
+  for (size_t i = 1; i < count; i++) {
+    if (frame(i).total_ms > frame(slowest_index).total_ms)
+      slowest_index = i;
+  }
+  return slowest_index;
+}
+
+size_t FrameStats::get_num_tracked() const {
+  return num_tracked;
+}
+
+const char* FrameStats::get_tracked_name(size_t tracked_index) const {
+  return tracked[tracked_index];
+}
+
+FrameStats::Summary FrameStats::summarize(int tracked_index) const {
+  Summary summary{};
+  if (count == 0)
+    return summary;
+  float values[HISTORY];
+  size_t n = 0;
+  double sum = 0.0;
+  for (size_t i = 0; i < count; i++) {
+    const Frame& f = frames[i];
+    if (tracked_index >= 0 && f.tracked_missing[tracked_index])
+      continue;
+    values[n] = tracked_index < 0 ? f.total_ms : f.tracked_ms[tracked_index];
+    sum += values[n];
+    n++;
+  }
+  if (n == 0)
+    return summary;
+  summary.average = (float)(sum / n);
+  summary.worst = *std::max_element(values, values + n);
+  summary.p50 = percentile(values, n, 0.50f);
+  summary.p95 = percentile(values, n, 0.95f);
+  summary.p99 = percentile(values, n, 0.99f);
+  return summary;
+}
+
+const FrameStats::Capture& FrameStats::get_last() const {
+  return last;
+}
+
+const FrameStats::Capture& FrameStats::get_slowest() const {
+  return slowest;
+}
+
+void FrameStats::reset_slowest() {
+  slowest.begin_ns = 0;
+  slowest.end_ns = 0;
+  slowest.num_zones = 0;
+}
+
+void FrameStats::clear() {
+  next = 0;
+  count = 0;
+  reset_slowest();
+}
+
+void FrameStats::set_frozen(bool frozen) {
+  this->frozen = frozen;
+}
+
+bool FrameStats::is_frozen() const {
+  return frozen;
+}
@@ -0,0 +1,105 @@
+#pragma once
+#include "profiler.h"
+
+#include <cstddef>
+#include <cstdint>
+#include <initializer_list>
+
+// Rolling per-frame timings built from the profiler's zones, for the
+// performance overlay. Everything lives in fixed-size arrays, so keeping
+// and reading the stats never allocates and the overlay doesn't show up in
+// what it measures.
+//
+// A frame runs from one end_frame() to the next. Its zones are those that
+// ended in that interval on any thread.
+class FrameStats {
+  public:
+    // About five seconds at 60 Hz.
+    static constexpr size_t HISTORY = 300;
+    static constexpr size_t MAX_TRACKED = 12;
+    static constexpr size_t MAX_ZONES = 512;
+    static constexpr uint32_t MAX_DEPTH = 16;
+
+    struct Frame {
+      float total_ms;
+      // Self time of each tracked zone name, summed over threads: time in
+      // zones of that name less time in zones nested inside them.
+      float tracked_ms[MAX_TRACKED];
+      // Names with no sample this frame, from mark_missing().
+      bool tracked_missing[MAX_TRACKED];
+    };
+
+    struct Summary {
+      float average;
+      float p50;
+      float p95;
+      float p99;
+      float worst;
+    };
+
+    // One frame's zones, for the flame view.
+    struct Capture {
+      int64_t begin_ns;
+      int64_t end_ns;
+      Profiler::Zone zones[MAX_ZONES];
+      size_t num_zones;
+    };
+
+  private:
+    const char* tracked[MAX_TRACKED];
+    size_t num_tracked;
+    Frame frames[HISTORY];
+    // Slot the next frame goes in, and how many are filled.
+    size_t next;
+    size_t count;
+    int64_t frame_begin_ns;
+    // From add_time() and mark_missing(), for the frame being recorded.
+    float added_ms[MAX_TRACKED];
+    bool missing[MAX_TRACKED];
+    // The frame being finished, before it is copied to last or slowest.
+    Capture current;
+    Capture last;
+    Capture slowest;
+    bool frozen;
+
+  public:
+    // tracked names the zones to break frames down by; extra names past
+    // MAX_TRACKED are ignored.
+    explicit FrameStats(std::initializer_list<const char*> tracked);
+    FrameStats(const FrameStats&) = delete;
+    FrameStats& operator=(const FrameStats&) = delete;
+
+    void end_frame();
+    // Adds time measured outside the profiler, such as GPU passes, to a
+    // tracked name in the frame being recorded. Unknown names are ignored.
+    void add_time(const char* name, float ms);
+    // Records that a name has no sample in the frame being recorded, such
+    // as a GPU pass whose timer results weren't in yet, so summarize()
+    // leaves the frame out for it rather than counting it as 0 ms.
+    void mark_missing(const char* name);
+
+    size_t size() const;
+    // 0 is the oldest frame kept.
+    const Frame& frame(size_t index) const;
+    // Index of the slowest frame kept.
+    size_t slowest_frame() const;
+
+    size_t get_num_tracked() const;
+    const char* get_tracked_name(size_t tracked_index) const;
+    // Over every frame kept, less those marked missing for the name;
+    // tracked_index -1 summarizes whole frames.
+    Summary summarize(int tracked_index) const;
+
+    const Capture& get_last() const;
+    // The slowest frame since the last reset_slowest(), which can be older
+    // than anything still in the history.
+    const Capture& get_slowest() const;
+    void reset_slowest();
+    // Forgets the history, e.g. once a benchmark has warmed up.
+    void clear();
+
+    // While frozen, get_last() keeps the frame it had so it can be
+    // inspected; the history carries on.
+    void set_frozen(bool frozen);
+    bool is_frozen() const;
+};
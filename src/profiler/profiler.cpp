@@ -0,0 +1,220 @@
+#include "profiler.h"
+
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <cstdio>
+#include <fstream>
+#include <iomanip>
+#include <memory>
+#include <mutex>
+
+namespace {
+  // 2 MiB a thread: several seconds of a frame loop's zones.
+  const size_t DEFAULT_ZONES_PER_THREAD = 1 << 16;
+
+  // One zone in a ring. The fields are atomics, loaded and stored relaxed
+  // (plain moves on x86), so collect() can copy a slot while its thread
+  // overwrites it without a data race; it then throws away whatever the
+  // thread may have been writing, see collect(). The thread is implied by
+  // the ring.
+  struct Slot {
+    std::atomic<const char*> name{nullptr};
+    std::atomic<int64_t> begin_ns{0};
+    std::atomic<int64_t> end_ns{0};
+    std::atomic<uint32_t> depth{0};
+
+    void store(const char* name, int64_t begin_ns, int64_t end_ns, uint32_t depth) {
+      this->name.store(name, std::memory_order_relaxed);
+      this->begin_ns.store(begin_ns, std::memory_order_relaxed);
+      this->end_ns.store(end_ns, std::memory_order_relaxed);
+      this->depth.store(depth, std::memory_order_relaxed);
+    }
+
+    Profiler::Zone load(uint32_t thread) const {
+      return Profiler::Zone{name.load(std::memory_order_relaxed),
+                            begin_ns.load(std::memory_order_relaxed),
+                            end_ns.load(std::memory_order_relaxed),
+                            depth.load(std::memory_order_relaxed),
+                            thread};
+    }
+  };
+
+  // Written only by its thread; read by collect() from any.
+  struct ThreadRing {
+    std::unique_ptr<Slot[]> zones;
+    size_t capacity;
+    // Zones ever recorded; the newest is at (written - 1) % capacity.
+    std::atomic<uint64_t> written{0};
+    uint32_t depth = 0;
+    uint32_t index = 0;
+    char name[32] = {};
+  };
+
+  // Rings are never freed, so the zones of threads that have exited
+  // still make it into the trace.
+  struct Registry {
+    std::mutex mutex;
+    std::vector<std::unique_ptr<ThreadRing>> rings;
+    std::atomic<size_t> zones_per_thread{DEFAULT_ZONES_PER_THREAD};
+    std::chrono::steady_clock::time_point epoch = std::chrono::steady_clock::now();
+  };
+
+  Registry& registry() {
+    static Registry instance{};
+    return instance;
+  }
+
+  thread_local ThreadRing* tls_ring = nullptr;
+
+  ThreadRing& this_thread_ring() {
+    if (!tls_ring) {
+      Registry& reg = registry();
+      auto ring = std::make_unique<ThreadRing>();
+      ring->capacity = std::max<size_t>(1, reg.zones_per_thread.load());
+      ring->zones = std::make_unique<Slot[]>(ring->capacity);
+      std::lock_guard<std::mutex> lock{reg.mutex};
+      ring->index = (uint32_t)reg.rings.size();
+      std::snprintf(ring->name, sizeof(ring->name), "thread %u", ring->index);
+      tls_ring = ring.get();
+      reg.rings.push_back(std::move(ring));
+    }
+    return *tls_ring;
+  }
+
+  void write_json_string(std::ostream& out, const char* text) {
+    out << '"';
+    for (const char* c = text; *c; c++) {
+      if (*c == '"' || *c == '\\')
+        out << '\\';
+      out << *c;
+    }
+    out << '"';
+  }
+}
+
+int64_t Profiler::now_ns() {
+  return std::chrono::duration_cast<std::chrono::nanoseconds>(
+      std::chrono::steady_clock::now() - registry().epoch).count();
+}
+
+void Profiler::set_thread_name(const char* name) {
+  ThreadRing& ring = this_thread_ring();
+  std::lock_guard<std::mutex> lock{registry().mutex};
+  std::snprintf(ring.name, sizeof(ring.name), "%s", name);
+}
+
+const char* Profiler::thread_name(uint32_t thread) {
+  Registry& reg = registry();
+  std::lock_guard<std::mutex> lock{reg.mutex};
+  return thread < reg.rings.size() ? reg.rings[thread]->name : "";
+}
+
+void Profiler::set_zones_per_thread(size_t count) {
+  registry().zones_per_thread.store(count);
+}
+
+void Profiler::collect(std::vector<Zone>& out) {
+  Registry& reg = registry();
+  std::lock_guard<std::mutex> lock{reg.mutex};
+  for (const auto& ring : reg.rings) {
+    uint64_t end = ring->written.load(std::memory_order_acquire);
+    uint64_t begin = end > ring->capacity ? end - ring->capacity : 0;
+    size_t start = out.size();
+    for (uint64_t i = begin; i < end; i++)
+      out.push_back(ring->zones[i % ring->capacity].load(ring->index));
+    // Anything the thread wrapped around to while we copied is torn,
+    // including the slot of zone number after, which it may be writing but
+    // hasn't published yet.
+    std::atomic_thread_fence(std::memory_order_acquire);
+    uint64_t after = ring->written.load(std::memory_order_relaxed);
+    if (after + 1 > ring->capacity && after + 1 - ring->capacity > begin) {
+      size_t torn = (size_t)std::min(after + 1 - ring->capacity - begin, end - begin);
+      out.erase(out.begin() + start, out.begin() + start + torn);
+    }
+  }
+}
+
+size_t Profiler::collect(int64_t since_ns, int64_t until_ns, Zone* out, size_t max) {
+  Registry& reg = registry();
+  std::lock_guard<std::mutex> lock{reg.mutex};
+  size_t count = 0;
+  for (const auto& ring : reg.rings) {
+    uint64_t end = ring->written.load(std::memory_order_acquire);
+    uint64_t oldest = end > ring->capacity ? end - ring->capacity : 0;
+    // A thread's zones are in the order they ended, so the ones wanted
+    // are a run at the newest end.
+    uint64_t begin = end;
+    while (begin > oldest &&
+           ring->zones[(begin - 1) % ring->capacity].end_ns.load(std::memory_order_relaxed) >= since_ns)
+      begin--;
+    size_t start = count;
+    for (uint64_t i = begin; i < end && count < max; i++) {
+      Zone zone = ring->zones[i % ring->capacity].load(ring->index);
+      if (zone.end_ns >= until_ns)
+        break;
+      out[count++] = zone;
+    }
+    std::atomic_thread_fence(std::memory_order_acquire);
+    uint64_t after = ring->written.load(std::memory_order_relaxed);
+    if (after + 1 > ring->capacity && after + 1 - ring->capacity > begin) {
+      size_t torn = (size_t)std::min<uint64_t>(after + 1 - ring->capacity - begin, count - start);
+      std::copy(out + start + torn, out + count, out + start);
+      count -= torn;
+    }
+  }
+  return count;
+}
+
+bool Profiler::write_chrome_trace(const std::string& path) {
+  std::vector<Zone> zones{};
+  collect(zones);
+  std::ofstream out{path};
+  if (!out)
+    return false;
+
+  uint32_t num_threads = 0;
+  for (const Zone& zone : zones)
+    num_threads = std::max(num_threads, zone.thread + 1);
+
+  // Complete ("X") events in microseconds, plus one name record a thread.
+  out << "{\"displayTimeUnit\":\"ms\",\"traceEvents\":[\n";
+  out << std::fixed << std::setprecision(3);
+  bool first = true;
+  for (uint32_t thread = 0; thread < num_threads; thread++) {
+    out << (first ? "" : ",\n") << "{\"ph\":\"M\",\"name\":\"thread_name\",\"pid\":1,\"tid\":" << thread
+        << ",\"args\":{\"name\":";
+    write_json_string(out, thread_name(thread));
+    out << "}}";
+    first = false;
+  }
+  for (const Zone& zone : zones) {
+    out << (first ? "" : ",\n") << "{\"ph\":\"X\",\"name\":";
+    write_json_string(out, zone.name);
+    out << ",\"pid\":1,\"tid\":" << zone.thread
+        << ",\"ts\":" << zone.begin_ns / 1000.0
+        << ",\"dur\":" << (zone.end_ns - zone.begin_ns) / 1000.0 << "}";
+    first = false;
+  }
+  out << "\n]}\n";
+  return (bool)out;
+}
+
+Profiler::Scope::Scope(const char* name) :
+                       name{name} {
+  this_thread_ring().depth++;
+  begin_ns = now_ns();
+}
+
+Profiler::Scope::~Scope() {
+  int64_t end_ns = now_ns();
+  ThreadRing& ring = *tls_ring;
+  ring.depth--;
+  uint64_t index = ring.written.load(std::memory_order_relaxed);
+  // Pairs with the fence in collect(): a reader that sees any of the
+  // slot's new fields also sees written reach index, and so knows the
+  // zone it was copying from the slot is torn.
+  std::atomic_thread_fence(std::memory_order_release);
+  ring.zones[index % ring.capacity].store(name, begin_ns, end_ns, ring.depth);
+  ring.written.store(index + 1, std::memory_order_release);
+}
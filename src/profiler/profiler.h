@@ -0,0 +1,66 @@
+#pragma once
+#include <cstddef>
+#include <cstdint>
+#include <string>
+#include <vector>
+
+// Scoped CPU zones for seeing where frame time goes. A Scope records its
+// name and start and end times into a ring owned by the calling thread, so
+// recording takes no lock and never allocates after a thread's first zone.
+// Each ring holds the newest zones_per_thread zones; older ones are
+// overwritten.
+//
+// Times come from steady_clock, which on Linux is a vDSO read of the TSC:
+// about as cheap as RDTSC without having to calibrate it.
+namespace Profiler {
+  struct Zone {
+    // A string literal; only the pointer is stored.
+    const char* name;
+    int64_t begin_ns;
+    int64_t end_ns;
+    // How many zones enclose this one on its thread.
+    uint32_t depth;
+    // Index of the recording thread, see thread_name().
+    uint32_t thread;
+  };
+
+  // Nanoseconds since the profiler's epoch, on the same clock as zones.
+  int64_t now_ns();
+
+  // Labels the calling thread in traces. Threads that never call it are
+  // named by their index. Creates the thread's ring if it has none yet.
+  void set_thread_name(const char* name);
+  const char* thread_name(uint32_t thread);
+
+  // Ring size for threads that haven't recorded a zone or been named yet,
+  // so set it before either. The default keeps a few seconds of a frame
+  // loop.
+  void set_zones_per_thread(size_t count);
+
+  // Appends every thread's zones that are still in its ring to out, each
+  // thread's in the order they ended. Safe to call while other threads
+  // record, ThreadSanitizer included: zones overwritten during the copy,
+  // and the one being written, are left out.
+  void collect(std::vector<Zone>& out);
+  // The zones that ended in [since_ns, until_ns), up to max of them, into
+  // out; returns how many. For per-frame stats: only walks back as far as
+  // since_ns, and never allocates.
+  size_t collect(int64_t since_ns, int64_t until_ns, Zone* out, size_t max);
+
+  // Writes the collected zones as Chrome trace_event JSON, for
+  // chrome://tracing or https://ui.perfetto.dev.
+  bool write_chrome_trace(const std::string& path);
+
+  // Records the time from construction to destruction as a zone.
+  class Scope {
+    private:
+      const char* name;
+      int64_t begin_ns;
+
+    public:
+      explicit Scope(const char* name);
+      ~Scope();
+      Scope(const Scope&) = delete;
+      Scope& operator=(const Scope&) = delete;
+  };
+}
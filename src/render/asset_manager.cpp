@@ -0,0 +1,141 @@
+#include "asset_manager.h"
+#include "gl_state.h"
+
+#include <algorithm>
+#include <chrono>
+#include <thread>
+
+AssetManager::AssetManager(JobSystem& jobs) :
+                           placeholder{0},
+                           stats{},
+                           jobs{jobs},
+                           decodes{jobs.create(nullptr)},
+                           stopping{false} {
+  // Magenta and black, so anything drawn with it stands out.
+  uint32_t checker[4] = {0xffff00ff, 0xff000000, 0xff000000, 0xffff00ff};
+  placeholder = Renderer::create_texture();
+  glTexImage2D(GL_TEXTURE_2D, 0, GL_RGBA8, 2, 2, 0, GL_RGBA, GL_UNSIGNED_BYTE, checker);
+  Renderer::set_texture_filter(placeholder, 1, Renderer::TextureFilter::NEAREST);
+}
+
+AssetManager::~AssetManager() {
+  // Jobs that haven't started skip their file; the wait covers the rest.
+  stopping.store(true);
+  jobs.submit(decodes);
+  jobs.wait(decodes);
+
+  for (const Entry& entry : entries)
+    GLState::delete_texture(entry.texture);
+  GLState::delete_texture(placeholder);
+}
+
+void AssetManager::decode(uint32_t index, const std::string& filename) {
+  if (stopping.load())
+    return;
+  TextureData data = TextureData::load(filename);
+  std::lock_guard<std::mutex> lock{mutex};
+  results.push_back(Result{index, std::move(data)});
+}
+
+AssetManager::TextureHandle AssetManager::load_texture(const std::string& filename,
+                                                       Renderer::TextureFilter filter) {
+  auto found = by_filename.find(filename);
+  if (found != by_filename.end())
+    return TextureHandle{found->second};
+
+  uint32_t index = (uint32_t)entries.size();
+  entries.push_back(Entry{filename, filter, State::DECODING, 0, {}, 0});
+  by_filename.emplace(filename, index);
+  jobs.run([this, index, filename] { decode(index, filename); }, decodes);
+  return TextureHandle{index};
+}
+
+void AssetManager::collect_results() {
+  std::vector<Result> done;
+  {
+    std::lock_guard<std::mutex> lock{mutex};
+    done.swap(results);
+  }
+  for (Result& result : done) {
+    Entry& entry = entries[result.index];
+    if (result.data.empty()) {
+      entry.state = State::FAILED;
+      continue;
+    }
+    entry.data = std::move(result.data);
+    entry.state = State::UPLOADING;
+    upload_queue.push_back(result.index);
+  }
+}
+
+void AssetManager::update(double budget_ms) {
+  using clock = std::chrono::steady_clock;
+  auto t_start = clock::now();
+  auto elapsed_ms = [&] {
+    return std::chrono::duration<double, std::milli>(clock::now() - t_start).count();
+  };
+
+  collect_results();
+  stats.levels_uploaded = 0;
+  while (!upload_queue.empty() && (stats.levels_uploaded == 0 || elapsed_ms() < budget_ms)) {
+    Entry& entry = entries[upload_queue.front()];
+    if (!entry.texture)
+      entry.texture = Renderer::create_texture();
+    // One level at a time, so a large base level is the most a single
+    // step can overrun the budget by.
+    size_t num_levels = Renderer::num_upload_levels(entry.data, entry.filter);
+    Renderer::upload_texture_level(entry.texture, entry.data, entry.next_level);
+    stats.levels_uploaded++;
+    if (++entry.next_level < num_levels)
+      continue;
+
+    Renderer::set_texture_filter(entry.texture, num_levels, entry.filter);
+    // Drops the decoded texels or unmaps the file.
+    entry.data = TextureData{};
+    entry.state = State::READY;
+    upload_queue.pop_front();
+  }
+  stats.upload_ms = elapsed_ms();
+}
+
+void AssetManager::finish() {
+  while (!is_idle()) {
+    update(1e9);
+    if (!is_idle())
+      std::this_thread::sleep_for(std::chrono::milliseconds(1));
+  }
+}
+
+GLuint AssetManager::get_texture(TextureHandle handle) const {
+  if (!handle.is_valid() || entries[handle.index].state != State::READY)
+    return placeholder;
+  return entries[handle.index].texture;
+}
+
+AssetManager::State AssetManager::get_state(TextureHandle handle) const {
+  if (!handle.is_valid())
+    return State::FAILED;
+  return entries[handle.index].state;
+}
+
+bool AssetManager::is_idle() const {
+  for (const Entry& entry : entries) {
+    if (entry.state == State::DECODING || entry.state == State::UPLOADING)
+      return false;
+  }
+  return true;
+}
+
+AssetManager::Stats AssetManager::get_stats() const {
+  Stats counts = stats;
+  counts.decoding = counts.uploading = counts.ready = counts.failed = 0;
+  for (const Entry& entry : entries) {
+    switch (entry.state) {
+      case State::DECODING: counts.decoding++; break;
+      case State::UPLOADING: counts.uploading++; break;
+      case State::READY: counts.ready++; break;
+      case State::FAILED: counts.failed++; break;
+    }
+  }
+  return counts;
+}
@@ -0,0 +1,105 @@
+#pragma once
+#include "render.h"
+#include "texture_data.h"
+
+#include "jobs/job_system.h"
+
+#include <glad/glad.h>
+#include <atomic>
+#include <cstddef>
+#include <cstdint>
+#include <deque>
+#include <mutex>
+#include <string>
+#include <unordered_map>
+#include <vector>
+
+// Loads textures in the background. load_texture() returns a handle at
+// once and queues the file as a decode job (disk read, PNG decode and
+// mipmapping, or mapping a baked .ktex) on the shared JobSystem. Decoded textures wait
+// for update(), which uploads them on the GL thread one mip level at a time
+// until the frame's time budget runs out. Until then a handle draws as a
+// small checkerboard, so the game can start before its assets are in.
+// With a one-thread JobSystem there is nowhere to decode in the background,
+// so load_texture() decodes before it returns.
+class AssetManager {
+  public:
+    struct TextureHandle {
+      uint32_t index = UINT32_MAX;
+      bool is_valid() const { return index != UINT32_MAX; }
+    };
+
+    enum class State {
+      DECODING,
+      UPLOADING,
+      READY,
+      FAILED
+    };
+
+    struct Stats {
+      uint32_t decoding = 0;
+      uint32_t uploading = 0;
+      uint32_t ready = 0;
+      uint32_t failed = 0;
+      // From the last update().
+      uint32_t levels_uploaded = 0;
+      double upload_ms = 0.0;
+    };
+
+  private:
+    struct Entry {
+      std::string filename;
+      Renderer::TextureFilter filter;
+      State state;
+      GLuint texture;
+      TextureData data;
+      size_t next_level;
+    };
+
+    struct Result {
+      uint32_t index;
+      TextureData data;
+    };
+
+    // Main thread only.
+    std::vector<Entry> entries;
+    std::unordered_map<std::string, uint32_t> by_filename;
+    std::deque<uint32_t> upload_queue;
+    GLuint placeholder;
+    Stats stats;
+
+    JobSystem& jobs;
+    // Parent of every decode job, so the destructor can wait for them all.
+    JobSystem::Job* decodes;
+
+    // Shared with the decode jobs.
+    std::mutex mutex;
+    std::vector<Result> results;
+    std::atomic<bool> stopping;
+
+    void decode(uint32_t index, const std::string& filename);
+    void collect_results();
+
+  public:
+    explicit AssetManager(JobSystem& jobs);
+    // Deletes every texture it created, so the GL context must still be current.
+    ~AssetManager();
+    AssetManager(const AssetManager&) = delete;
+    AssetManager& operator=(const AssetManager&) = delete;
+
+    // Loading the same file twice returns the same handle.
+    TextureHandle load_texture(const std::string& filename,
+                               Renderer::TextureFilter filter = Renderer::TextureFilter::ANISOTROPIC);
+
+    // Uploads decoded textures until budget_ms has passed. Always makes some
+    // progress, so a tiny budget slows loading down but never stalls it.
+    void update(double budget_ms);
+    // Blocks until every queued texture is ready or has failed.
+    void finish();
+
+    // The placeholder until the texture is READY, and for good if it FAILED.
+    GLuint get_texture(TextureHandle handle) const;
+    State get_state(TextureHandle handle) const;
+    bool is_idle() const;
+    Stats get_stats() const;
+};
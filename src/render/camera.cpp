@@ -4,6 +4,7 @@
 #include "glm/trigonometric.hpp"
 #include "glm/gtx/string_cast.hpp"
 
+#include <cmath>
 #include <iostream>
 
 Camera::Camera(glm::vec3 position,
@@ -19,6 +20,16 @@ Camera::Camera(glm::vec3 position,
   update();
 }
 
+Camera Camera::look_along(glm::vec3 position, glm::vec3 front, glm::vec3 up) {
+  Camera cam{position, up};
+  cam.front = glm::normalize(front);
+  // Only kept for callers that read the angles back; nothing derives from them.
+  cam.yaw = glm::degrees(std::atan2(cam.front.z, cam.front.x));
+  cam.pitch = glm::degrees(std::asin(cam.front.y));
+  cam.update_basis();
+  return cam;
+}
+
 void Camera::move_forward(float ticks) {
   position += front * (float)(ticks * 0.3);
 }
@@ -40,13 +51,40 @@ glm::mat4 Camera::get_view_matrix() const {
   return glm::lookAt(position, position + front, up);
 }
 
+glm::vec3 Camera::get_position() const {
+  return position;
+}
+
+glm::vec3 Camera::get_world_up() const {
+  return world_up;
+}
+
+glm::vec3 Camera::get_front() const {
+  return front;
+}
+
+glm::vec3 Camera::get_up() const {
+  return up;
+}
+
+glm::vec3 Camera::get_right() const {
+  return right;
+}
+
+float Camera::get_yaw() const {
+  return yaw;
+}
+
+float Camera::get_pitch() const {
+  return pitch;
+}
+
 void Camera::update() {
   front.x = cos(glm::radians(yaw)) * cos(glm::radians(pitch));
   front.y = sin(glm::radians(pitch));
   front.z = sin(glm::radians(yaw)) * cos(glm::radians(pitch));
   front = glm::normalize(front);
-  right = glm::normalize(glm::cross(front, world_up));
-  up = glm::normalize(glm::cross(right, front));
+  update_basis();
 
   /*
   std::cout << "position: " << glm::to_string(this->position) << "\n";
@@ -57,3 +95,8 @@ void Camera::update() {
   std::cout << "movement_speed: " << this->movement_speed << "\n";
   */
 }
+
+void Camera::update_basis() {
+  right = glm::normalize(glm::cross(front, world_up));
+  up = glm::normalize(glm::cross(right, front));
+}
@@ -11,12 +11,26 @@ class Camera {
   float yaw;
   float pitch;
   float movement_speed;
+
+  void update_basis();
   public:
     Camera(glm::vec3 position = glm::vec3(0.f, 0.f, 0.f),
            glm::vec3 up = glm::vec3(0.f, 1.f, 0.f),
            float yaw = -90.f,
            float pitch = 0.f);
+    // Camera facing front, which need not be normalized. Builds the basis
+    // with cross products only, so cameras derived from simulation state
+    // don't depend on the platform's cos and sin.
+    static Camera look_along(glm::vec3 position, glm::vec3 front,
+                             glm::vec3 up = glm::vec3(0.f, 1.f, 0.f));
     glm::mat4 get_view_matrix() const;
+    glm::vec3 get_position() const;
+    glm::vec3 get_world_up() const;
+    glm::vec3 get_front() const;
+    glm::vec3 get_up() const;
+    glm::vec3 get_right() const;
+    float get_yaw() const;
+    float get_pitch() const;
     void move_forward(float ticks);
     void move_backward(float ticks);
     void turn_left(float ticks);
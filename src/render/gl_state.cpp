@@ -0,0 +1,187 @@
+#include "gl_state.h"
+
+namespace {
+  const GLuint UNKNOWN = 0xffffffff;
+
+  const GLenum TRACKED_BUFFER_TARGETS[] = {
+    GL_ARRAY_BUFFER,
+    GL_ELEMENT_ARRAY_BUFFER,
+    GL_COPY_READ_BUFFER,
+    GL_COPY_WRITE_BUFFER,
+    GL_PIXEL_PACK_BUFFER,
+    GL_PIXEL_UNPACK_BUFFER,
+    GL_UNIFORM_BUFFER,
+  };
+  const int NUM_BUFFER_TARGETS = sizeof(TRACKED_BUFFER_TARGETS) / sizeof(TRACKED_BUFFER_TARGETS[0]);
+  const int ELEMENT_ARRAY_SLOT = 1;
+
+  struct Shadow {
+    GLuint program = UNKNOWN;
+    GLuint vao = UNKNOWN;
+    GLuint buffers[NUM_BUFFER_TARGETS];
+    GLuint active_texture_unit = UNKNOWN;
+    GLuint textures_2d[GLState::MAX_TEXTURE_UNITS];
+    int blend_enabled = -1;
+    GLenum blend_src = UNKNOWN;
+    GLenum blend_dst = UNKNOWN;
+    int depth_test_enabled = -1;
+    int depth_mask = -1;
+
+    Shadow() {
+      for (auto& b : buffers)
+        b = UNKNOWN;
+      for (auto& t : textures_2d)
+        t = UNKNOWN;
+    }
+  };
+
+  Shadow shadow{};
+  GLState::Stats stats{};
+  GLState::Stats frame_stats{};
+
+  int buffer_slot(GLenum target) {
+    for (int i = 0; i < NUM_BUFFER_TARGETS; i++) {
+      if (TRACKED_BUFFER_TARGETS[i] == target)
+        return i;
+    }
+    return -1;
+  }
+
+  // Returns true if the call must be issued, updating the shadow value.
+  template <typename T>
+  bool changed(T& current, T value) {
+    if (current == value) {
+      stats.elided++;
+      return false;
+    }
+    current = value;
+    stats.issued++;
+    return true;
+  }
+
+  void set_active_texture(GLuint unit) {
+    if (changed(shadow.active_texture_unit, unit))
+      glActiveTexture(GL_TEXTURE0 + unit);
+  }
+}
+
+void GLState::use_program(GLuint program) {
+  if (changed(shadow.program, program))
+    glUseProgram(program);
+}
+
+void GLState::bind_vertex_array(GLuint vao) {
+  if (changed(shadow.vao, vao)) {
+    glBindVertexArray(vao);
+    // The element array binding is part of the VAO.
+    shadow.buffers[ELEMENT_ARRAY_SLOT] = UNKNOWN;
+  }
+}
+
+void GLState::bind_buffer(GLenum target, GLuint buffer) {
+  int slot = buffer_slot(target);
+  if (slot < 0) {
+    stats.issued++;
+    glBindBuffer(target, buffer);
+    return;
+  }
+  if (changed(shadow.buffers[slot], buffer))
+    glBindBuffer(target, buffer);
+}
+
+void GLState::bind_texture(GLuint unit, GLenum target, GLuint texture) {
+  if (target != GL_TEXTURE_2D || unit >= (GLuint)MAX_TEXTURE_UNITS) {
+    set_active_texture(unit);
+    stats.issued++;
+    glBindTexture(target, texture);
+    return;
+  }
+  // Select the unit even when the bind is skipped: callers go on to edit
+  // whatever is bound to the active unit.
+  set_active_texture(unit);
+  if (shadow.textures_2d[unit] == texture) {
+    stats.elided++;
+    return;
+  }
+  changed(shadow.textures_2d[unit], texture);
+  glBindTexture(target, texture);
+}
+
+void GLState::set_blend(bool enabled) {
+  if (changed(shadow.blend_enabled, (int)enabled)) {
+    if (enabled)
+      glEnable(GL_BLEND);
+    else
+      glDisable(GL_BLEND);
+  }
+}
+
+void GLState::blend_func(GLenum src, GLenum dst) {
+  if (shadow.blend_src == src && shadow.blend_dst == dst) {
+    stats.elided++;
+    return;
+  }
+  shadow.blend_src = src;
+  shadow.blend_dst = dst;
+  stats.issued++;
+  glBlendFunc(src, dst);
+}
+
+void GLState::set_depth_test(bool enabled) {
+  if (changed(shadow.depth_test_enabled, (int)enabled)) {
+    if (enabled)
+      glEnable(GL_DEPTH_TEST);
+    else
+      glDisable(GL_DEPTH_TEST);
+  }
+}
+
+void GLState::depth_mask(bool enabled) {
+  if (changed(shadow.depth_mask, (int)enabled))
+    glDepthMask(enabled ? GL_TRUE : GL_FALSE);
+}
+
+void GLState::delete_program(GLuint program) {
+  if (shadow.program == program)
+    shadow.program = UNKNOWN;
+  glDeleteProgram(program);
+}
+
+void GLState::delete_vertex_array(GLuint vao) {
+  if (shadow.vao == vao)
+    shadow.vao = UNKNOWN;
+  glDeleteVertexArrays(1, &vao);
+}
+
+void GLState::delete_buffer(GLuint buffer) {
+  for (auto& b : shadow.buffers) {
+    if (b == buffer)
+      b = UNKNOWN;
+  }
+  glDeleteBuffers(1, &buffer);
+}
+
+void GLState::delete_texture(GLuint texture) {
+  for (auto& t : shadow.textures_2d) {
+    if (t == texture)
+      t = UNKNOWN;
+  }
+  glDeleteTextures(1, &texture);
+}
+
+void GLState::invalidate() {
+  shadow = Shadow{};
+}
+
+GLState::Stats GLState::get_stats() {
+  return stats;
+}
+
+GLState::Stats GLState::get_frame_stats() {
+  return frame_stats;
+}
+
+void GLState::end_frame() {
+  frame_stats = stats;
+  stats = Stats{};
+}
@@ -0,0 +1,55 @@
+#pragma once
+#include <glad/glad.h>
+#include <cstdint>
+
+// Shadow copy of the GL binding state we touch. Each setter compares with
+// the last value it issued and skips the driver call when nothing changes.
+//
+// Anything that changes GL state behind our back must be followed by
+// invalidate(). The ImGui OpenGL3 backend saves and restores every binding
+// it touches, so the shadow state is still valid after it renders.
+namespace GLState {
+  struct Stats {
+    uint64_t issued = 0;
+    uint64_t elided = 0;
+  };
+
+  const int MAX_TEXTURE_UNITS = 16;
+
+  void use_program(GLuint program);
+
+  void bind_vertex_array(GLuint vao);
+
+  void bind_buffer(GLenum target, GLuint buffer);
+
+  // unit is an index (0, 1, ...), not GL_TEXTURE0 + index. Leaves unit
+  // active, bound or not, so the texture can be edited straight after.
+  void bind_texture(GLuint unit, GLenum target, GLuint texture);
+
+  void set_blend(bool enabled);
+
+  void blend_func(GLenum src, GLenum dst);
+
+  void set_depth_test(bool enabled);
+
+  // glDepthMask; also gates glClear of the depth buffer.
+  void depth_mask(bool enabled);
+
+  // Delete through these so a recycled name is never mistaken for one that
+  // is still bound.
+  void delete_program(GLuint program);
+  void delete_vertex_array(GLuint vao);
+  void delete_buffer(GLuint buffer);
+  void delete_texture(GLuint texture);
+
+  // Forget everything, the next call to each setter goes to the driver.
+  void invalidate();
+
+  // Counts since the last end_frame().
+  Stats get_stats();
+
+  // Counts for the most recently completed frame.
+  Stats get_frame_stats();
+
+  void end_frame();
+}
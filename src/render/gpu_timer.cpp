@@ -0,0 +1,87 @@
+#include "gpu_timer.h"
+
+#include <algorithm>
+
+GpuTimer::Scope::Scope(GpuTimer* timer, size_t pass) :
+                       timer{timer && pass < timer->num_passes ? timer : nullptr} {
+  if (!this->timer)
+    return;
+  uint32_t slot = this->timer->frame % LATENCY;
+  glBeginQuery(GL_TIME_ELAPSED, this->timer->queries[slot][pass]);
+  this->timer->pending[slot][pass] = true;
+}
+
+GpuTimer::Scope::~Scope() {
+  if (timer)
+    glEndQuery(GL_TIME_ELAPSED);
+}
+
+GpuTimer::GpuTimer(const char* const* names, size_t num_passes) :
+                   names{},
+                   num_passes{std::min(num_passes, MAX_PASSES)},
+                   queries{},
+                   pending{},
+                   frame{0},
+                   pass_ms{},
+                   has_results{false},
+                   warmed_up{false},
+                   dropped{0} {
+  std::copy(names, names + this->num_passes, this->names);
+  glGenQueries(LATENCY * MAX_PASSES, &queries[0][0]);
+}
+
+GpuTimer::~GpuTimer() {
+  glDeleteQueries(LATENCY * MAX_PASSES, &queries[0][0]);
+}
+
+void GpuTimer::begin_frame() {
+  frame++;
+  uint32_t slot = frame % LATENCY;
+  has_results = false;
+  bool any_pending = false;
+  bool ready = true;
+  for (size_t pass = 0; pass < num_passes; pass++) {
+    if (!pending[slot][pass])
+      continue;
+    any_pending = true;
+    GLint available = 0;
+    glGetQueryObjectiv(queries[slot][pass], GL_QUERY_RESULT_AVAILABLE, &available);
+    ready = ready && available;
+  }
+  if (any_pending && !ready) {
+    dropped++;
+  } else if (any_pending && !warmed_up) {
+    // llvmpipe counts everything since the context was created in the
+    // first query, so the first frame read back is thrown away.
+    warmed_up = true;
+  } else if (any_pending) {
+    for (size_t pass = 0; pass < num_passes; pass++) {
+      GLuint64 ns = 0;
+      if (pending[slot][pass])
+        glGetQueryObjectui64v(queries[slot][pass], GL_QUERY_RESULT, &ns);
+      pass_ms[pass] = (float)(ns / 1e6);
+    }
+    has_results = true;
+  }
+  std::fill(pending[slot], pending[slot] + MAX_PASSES, false);
+}
+
+size_t GpuTimer::get_num_passes() const {
+  return num_passes;
+}
+
+const char* GpuTimer::get_pass_name(size_t pass) const {
+  return names[pass];
+}
+
+float GpuTimer::get_pass_ms(size_t pass) const {
+  return pass_ms[pass];
+}
+
+bool GpuTimer::get_has_results() const {
+  return has_results;
+}
+
+uint64_t GpuTimer::get_dropped() const {
+  return dropped;
+}
@@ -0,0 +1,65 @@
+#pragma once
+#include <glad/glad.h>
+#include <cstddef>
+#include <cstdint>
+
+// GPU time per render pass from GL_TIME_ELAPSED queries. Each frame's
+// queries are read back LATENCY frames later, by which point the GPU has
+// long finished them, so asking for a result never waits on the pipeline.
+// A frame whose results still aren't in by then is dropped and counted
+// rather than waited for.
+//
+// Timer queries are core since GL 3.3, so this works on any context the
+// game runs on, Mesa's llvmpipe included. GL_TIME_ELAPSED queries can't
+// nest: passes must be timed one after another.
+class GpuTimer {
+  public:
+    static constexpr uint32_t LATENCY = 4;
+    static constexpr size_t MAX_PASSES = 8;
+
+    // Times the GL commands issued during its lifetime as pass. A null
+    // timer times nothing.
+    class Scope {
+      private:
+        GpuTimer* timer;
+
+      public:
+        Scope(GpuTimer* timer, size_t pass);
+        ~Scope();
+        Scope(const Scope&) = delete;
+        Scope& operator=(const Scope&) = delete;
+    };
+
+  private:
+    const char* names[MAX_PASSES];
+    size_t num_passes;
+    GLuint queries[LATENCY][MAX_PASSES];
+    // Which queries of a frame were issued and not yet read back.
+    bool pending[LATENCY][MAX_PASSES];
+    uint32_t frame;
+    float pass_ms[MAX_PASSES];
+    bool has_results;
+    // Whether the first frame has been read back; see begin_frame().
+    bool warmed_up;
+    uint64_t dropped;
+
+  public:
+    // names labels each pass; at most MAX_PASSES are timed.
+    GpuTimer(const char* const* names, size_t num_passes);
+    ~GpuTimer();
+    GpuTimer(const GpuTimer&) = delete;
+    GpuTimer& operator=(const GpuTimer&) = delete;
+
+    // Call before any pass of a frame. Reads back the frame LATENCY frames
+    // ago and reuses its queries for this one.
+    void begin_frame();
+
+    size_t get_num_passes() const;
+    const char* get_pass_name(size_t pass) const;
+    // From the newest frame read back, 0 for passes it didn't run.
+    float get_pass_ms(size_t pass) const;
+    // Whether the last begin_frame() read a frame back.
+    bool get_has_results() const;
+    // Frames skipped because their results weren't ready in time.
+    uint64_t get_dropped() const;
+};
@@ -0,0 +1,54 @@
+#include "mip_chain.h"
+
+#include <algorithm>
+
+namespace {
+  uint32_t average4(uint32_t a, uint32_t b, uint32_t c, uint32_t d) {
+    uint32_t out = 0;
+    for (int shift = 0; shift < 32; shift += 8) {
+      uint32_t sum = ((a >> shift) & 0xff) + ((b >> shift) & 0xff) +
+                     ((c >> shift) & 0xff) + ((d >> shift) & 0xff);
+      out |= ((sum + 2) / 4) << shift;
+    }
+    return out;
+  }
+}
+
+const uint32_t* MipChain::level_data(size_t level) const {
+  return texels.data() + levels[level].offset;
+}
+
+size_t MipChain::num_levels() const {
+  return levels.size();
+}
+
+MipChain MipChain::build(const uint32_t* rgba, int width, int height, size_t max_levels) {
+  MipChain chain{};
+  size_t total = 0;
+  for (int w = width, h = height; chain.levels.size() < max_levels; w = std::max(1, w / 2), h = std::max(1, h / 2)) {
+    chain.levels.push_back(Level{w, h, total});
+    total += (size_t)w * h;
+    if (w == 1 && h == 1)
+      break;
+  }
+
+  chain.texels.resize(total);
+  std::copy(rgba, rgba + (size_t)width * height, chain.texels.begin());
+  for (size_t i = 1; i < chain.levels.size(); i++) {
+    const Level& src = chain.levels[i - 1];
+    const Level& dst = chain.levels[i];
+    const uint32_t* in = chain.texels.data() + src.offset;
+    uint32_t* out = chain.texels.data() + dst.offset;
+    for (int y = 0; y < dst.height; y++) {
+      int y0 = std::min(y * 2, src.height - 1);
+      int y1 = std::min(y * 2 + 1, src.height - 1);
+      for (int x = 0; x < dst.width; x++) {
+        int x0 = std::min(x * 2, src.width - 1);
+        int x1 = std::min(x * 2 + 1, src.width - 1);
+        out[y * dst.width + x] = average4(in[y0 * src.width + x0], in[y0 * src.width + x1],
+                                          in[y1 * src.width + x0], in[y1 * src.width + x1]);
+      }
+    }
+  }
+  return chain;
+}
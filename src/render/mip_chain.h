@@ -0,0 +1,24 @@
+#pragma once
+#include <cstddef>
+#include <cstdint>
+#include <vector>
+
+// An RGBA8 image and all of its mip levels, stored back to back.
+struct MipChain {
+  struct Level {
+    int width;
+    int height;
+    // Index of the level's first texel in texels.
+    size_t offset;
+  };
+
+  std::vector<Level> levels;
+  std::vector<uint32_t> texels;
+
+  const uint32_t* level_data(size_t level) const;
+  size_t num_levels() const;
+
+  // Builds levels down to 1x1 with a 2x2 box filter. Odd sizes clamp at the
+  // right and bottom edge. max_levels of 1 keeps only the base image.
+  static MipChain build(const uint32_t* rgba, int width, int height, size_t max_levels = SIZE_MAX);
+};
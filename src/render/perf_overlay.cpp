@@ -0,0 +1,180 @@
+#include "perf_overlay.h"
+#include "profiler/frame_stats.h"
+#include "imgui/imgui.h"
+
+#include <algorithm>
+#include <cstdint>
+#include <cstdio>
+
+namespace {
+  const float BUDGET_MS = 1000.f / 60.f;
+  const float LANE_ROW_HEIGHT = 18.f;
+  const uint32_t MAX_LANES = 32;
+
+  // Same colour for a zone name every frame, from its characters rather
+  // than its address so copies of a literal in different files agree.
+  ImU32 zone_color(const char* name) {
+    uint32_t hash = 2166136261u;
+    for (const char* c = name; *c; c++)
+      hash = (hash ^ (uint8_t)*c) * 16777619u;
+    float hue = (hash % 360) / 360.f;
+    float r, g, b;
+    ImGui::ColorConvertHSVtoRGB(hue, 0.55f, 0.85f, r, g, b);
+    return ImGui::GetColorU32(ImVec4(r, g, b, 1.f));
+  }
+
+  float frame_ms(void* data, int index) {
+    return ((const FrameStats*)data)->frame((size_t)index).total_ms;
+  }
+
+  void summary_row(const char* name, const FrameStats::Summary& s) {
+    ImGui::TableNextRow();
+    ImGui::TableNextColumn();
+    ImGui::TextUnformatted(name);
+    const float values[] = {s.average, s.p50, s.p95, s.p99, s.worst};
+    for (float value : values) {
+      ImGui::TableNextColumn();
+      ImGui::Text("%.2f", value);
+    }
+  }
+
+  void draw_table(const FrameStats& stats) {
+    ImGuiTableFlags flags = ImGuiTableFlags_RowBg | ImGuiTableFlags_BordersInnerV | ImGuiTableFlags_SizingFixedFit;
+    if (!ImGui::BeginTable("zones", 6, flags))
+      return;
+    const char* headers[] = {"ms", "avg", "p50", "p95", "p99", "worst"};
+    for (const char* header : headers)
+      ImGui::TableSetupColumn(header);
+    ImGui::TableHeadersRow();
+    summary_row("frame", stats.summarize(-1));
+    for (size_t i = 0; i < stats.get_num_tracked(); i++)
+      summary_row(stats.get_tracked_name(i), stats.summarize((int)i));
+    ImGui::EndTable();
+  }
+
+  void draw_histogram(const FrameStats& stats) {
+    FrameStats::Summary total = stats.summarize(-1);
+    float scale_max = std::max(total.worst, BUDGET_MS * 2.f) * 1.1f;
+    char overlay[64];
+    std::snprintf(overlay, sizeof(overlay), "p95 %.2f  p99 %.2f ms", total.p95, total.p99);
+    ImGui::PlotHistogram("##frames", frame_ms, (void*)&stats, (int)stats.size(), 0, overlay,
+                         0.f, scale_max, ImVec2(ImGui::GetContentRegionAvail().x, 80.f));
+
+    // Lines across for the budget and the percentiles, and a tick above
+    // the slowest frame.
+    ImVec2 min = ImGui::GetItemRectMin();
+    ImVec2 max = ImGui::GetItemRectMax();
+    ImDrawList* draw_list = ImGui::GetWindowDrawList();
+    auto y_of = [&](float ms) {
+      return max.y - (max.y - min.y) * std::min(ms / scale_max, 1.f);
+    };
+    draw_list->AddLine(ImVec2(min.x, y_of(BUDGET_MS)), ImVec2(max.x, y_of(BUDGET_MS)), IM_COL32(80, 220, 80, 200));
+    draw_list->AddLine(ImVec2(min.x, y_of(total.p95)), ImVec2(max.x, y_of(total.p95)), IM_COL32(240, 200, 60, 200));
+    draw_list->AddLine(ImVec2(min.x, y_of(total.p99)), ImVec2(max.x, y_of(total.p99)), IM_COL32(240, 120, 40, 200));
+    if (stats.size() > 0) {
+      float x = min.x + (max.x - min.x) * (stats.slowest_frame() + 0.5f) / stats.size();
+      draw_list->AddTriangleFilled(ImVec2(x - 4.f, min.y), ImVec2(x + 4.f, min.y), ImVec2(x, min.y + 6.f),
+                                   IM_COL32(240, 60, 60, 255));
+    }
+    ImGui::TextColored(ImVec4(0.3f, 0.85f, 0.3f, 1.f), "budget %.1f ms", BUDGET_MS);
+    ImGui::SameLine();
+    ImGui::TextColored(ImVec4(0.95f, 0.8f, 0.25f, 1.f), "p95");
+    ImGui::SameLine();
+    ImGui::TextColored(ImVec4(0.95f, 0.47f, 0.15f, 1.f), "p99");
+    ImGui::SameLine();
+    ImGui::TextColored(ImVec4(0.95f, 0.25f, 0.25f, 1.f), "slowest");
+  }
+
+  // One lane per thread that recorded anything, zones stacked by depth.
+  void draw_flame(const FrameStats::Capture& capture) {
+    if (capture.num_zones == 0 || capture.end_ns <= capture.begin_ns) {
+      ImGui::TextUnformatted("No zones recorded.");
+      return;
+    }
+    uint32_t lane_depth[MAX_LANES] = {};
+    bool lane_used[MAX_LANES] = {};
+    for (size_t i = 0; i < capture.num_zones; i++) {
+      const Profiler::Zone& zone = capture.zones[i];
+      if (zone.thread >= MAX_LANES)
+        continue;
+      lane_used[zone.thread] = true;
+      lane_depth[zone.thread] = std::max(lane_depth[zone.thread], zone.depth + 1);
+    }
+    float lane_y[MAX_LANES] = {};
+    float height = 0.f;
+    for (uint32_t t = 0; t < MAX_LANES; t++) {
+      if (!lane_used[t])
+        continue;
+      lane_y[t] = height;
+      // A row for the thread's name, then one per depth.
+      height += LANE_ROW_HEIGHT * (lane_depth[t] + 1);
+    }
+
+    ImVec2 origin = ImGui::GetCursorScreenPos();
+    float width = std::max(ImGui::GetContentRegionAvail().x, 100.f);
+    ImGui::InvisibleButton("##flame", ImVec2(width, height));
+    bool hovered = ImGui::IsItemHovered();
+    ImVec2 mouse = ImGui::GetIO().MousePos;
+    ImDrawList* draw_list = ImGui::GetWindowDrawList();
+    double ns_to_x = width / (double)(capture.end_ns - capture.begin_ns);
+
+    for (uint32_t t = 0; t < MAX_LANES; t++) {
+      if (lane_used[t])
+        draw_list->AddText(ImVec2(origin.x, origin.y + lane_y[t]), ImGui::GetColorU32(ImGuiCol_TextDisabled),
+                           Profiler::thread_name(t));
+    }
+    const Profiler::Zone* hovered_zone = nullptr;
+    for (size_t i = 0; i < capture.num_zones; i++) {
+      const Profiler::Zone& zone = capture.zones[i];
+      if (zone.thread >= MAX_LANES)
+        continue;
+      float x0 = origin.x + (float)(std::max<int64_t>(zone.begin_ns - capture.begin_ns, 0) * ns_to_x);
+      float x1 = origin.x + (float)((zone.end_ns - capture.begin_ns) * ns_to_x);
+      x1 = std::max(x1, x0 + 1.f);
+      float y0 = origin.y + lane_y[zone.thread] + LANE_ROW_HEIGHT * (zone.depth + 1);
+      float y1 = y0 + LANE_ROW_HEIGHT - 1.f;
+      draw_list->AddRectFilled(ImVec2(x0, y0), ImVec2(x1, y1), zone_color(zone.name));
+      // Only label zones wide enough to fit a few characters.
+      if (x1 - x0 > 30.f) {
+        draw_list->PushClipRect(ImVec2(x0, y0), ImVec2(x1, y1), true);
+        draw_list->AddText(ImVec2(x0 + 2.f, y0 + 1.f), IM_COL32(20, 20, 20, 255), zone.name);
+        draw_list->PopClipRect();
+      }
+      if (hovered && mouse.x >= x0 && mouse.x < x1 && mouse.y >= y0 && mouse.y < y1)
+        hovered_zone = &zone;
+    }
+    if (hovered_zone) {
+      ImGui::BeginTooltip();
+      ImGui::Text("%s: %.3f ms", hovered_zone->name, (hovered_zone->end_ns - hovered_zone->begin_ns) / 1e6);
+      ImGui::Text("thread: %s", Profiler::thread_name(hovered_zone->thread));
+      ImGui::EndTooltip();
+    }
+  }
+}
+
+void PerfOverlay::draw(FrameStats& stats) {
+  static bool show_slowest = false;
+  ImGui::SetNextWindowPos(ImVec2(740.f, 20.f), ImGuiCond_FirstUseEver);
+  ImGui::SetNextWindowSize(ImVec2(520.f, 620.f), ImGuiCond_FirstUseEver);
+  if (!ImGui::Begin("Performance")) {
+    ImGui::End();
+    return;
+  }
+  ImGui::Text("Last %zu frames: CPU self time per zone, GPU time per pass", stats.size());
+  draw_table(stats);
+  draw_histogram(stats);
+
+  ImGui::Separator();
+  bool frozen = stats.is_frozen();
+  if (ImGui::Checkbox("Freeze", &frozen))
+    stats.set_frozen(frozen);
+  ImGui::SameLine();
+  ImGui::Checkbox("Slowest frame", &show_slowest);
+  ImGui::SameLine();
+  if (ImGui::Button("Reset slowest"))
+    stats.reset_slowest();
+  const FrameStats::Capture& capture = show_slowest ? stats.get_slowest() : stats.get_last();
+  ImGui::Text("%.2f ms, %zu zones", (capture.end_ns - capture.begin_ns) / 1e6, capture.num_zones);
+  draw_flame(capture);
+  ImGui::End();
+}
@@ -0,0 +1,12 @@
+#pragma once
+
+class FrameStats;
+
+// ImGui window over FrameStats: a percentile table per tracked zone, a
+// frame-time histogram with budget, p95/p99 and slowest-frame markers, and
+// a flame view of one frame's zones with a lane per thread. Draws with
+// ImGui's own buffers and formats into the stack, so it adds no heap
+// allocations of its own.
+namespace PerfOverlay {
+  void draw(FrameStats& stats);
+}
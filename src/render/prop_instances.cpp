@@ -0,0 +1,122 @@
+#include "prop_instances.h"
+#include "render.h"
+#include "gl_state.h"
+
+PropInstances::PropInstances(GLuint texture) :
+                             vao{0},
+                             vbo{0},
+                             ebo{0},
+                             instance_vbo{0},
+                             texture{texture},
+                             uploaded_capacity{0},
+                             dirty{false} {
+  const GLchar* vert_shader_source =
+    #include "shaders/prop_vert.glsl"
+    ;
+  const GLchar* frag_shader_source =
+    #include "shaders/prop_frag.glsl"
+    ;
+  GLuint vert_shader = Renderer::compile_shader(vert_shader_source, "VERTEX");
+  GLuint frag_shader = Renderer::compile_shader(frag_shader_source, "FRAGMENT");
+  program = ShaderProgram{Renderer::build_shader_program(vert_shader, frag_shader)};
+  glDeleteShader(vert_shader);
+  glDeleteShader(frag_shader);
+  view_projection = program.uniform<glm::mat4>("view_projection");
+  tex = program.uniform<GLint>("tex");
+
+  GLfloat vertices[] = {
+  // x, y, z              u, v
+    -0.5f, 1.0f, 0.0f,    0.0f, 0.0f,
+     0.5f, 1.0f, 0.0f,    1.0f, 0.0f,
+     0.5f, 0.0f, 0.0f,    1.0f, 1.0f,
+    -0.5f, 0.0f, 0.0f,    0.0f, 1.0f
+  };
+
+  GLuint elements[] = {
+    0, 1, 2,
+    2, 3, 0
+  };
+
+  Renderer::set_vertex_array(&vao);
+  Renderer::set_buffer(GL_ARRAY_BUFFER, &vbo);
+  Renderer::set_buffer(GL_ELEMENT_ARRAY_BUFFER, &ebo);
+  Renderer::buffer_data(GL_ARRAY_BUFFER, vertices, sizeof(vertices));
+  Renderer::buffer_data(GL_ELEMENT_ARRAY_BUFFER, elements, sizeof(elements));
+  Renderer::setup_shader_attributes(program, {
+    {
+      .name = "pos",
+      .type = GL_FLOAT,
+      .num_components = 3
+    },
+    {
+      .name = "texcoord",
+      .type = GL_FLOAT,
+      .num_components = 2
+    }
+  });
+
+  Renderer::set_buffer(GL_ARRAY_BUFFER, &instance_vbo);
+  Renderer::setup_shader_attributes(program, {
+    {
+      .name = "transform",
+      .type = GL_FLOAT,
+      .num_components = 16,
+      .divisor = 1
+    },
+    {
+      .name = "atlas_rect",
+      .type = GL_FLOAT,
+      .num_components = 4,
+      .divisor = 1
+    }
+  });
+}
+
+PropInstances::~PropInstances() {
+  GLState::delete_buffer(instance_vbo);
+  GLState::delete_buffer(vbo);
+  GLState::delete_buffer(ebo);
+  GLState::delete_vertex_array(vao);
+  GLState::delete_program(program.get_id());
+}
+
+void PropInstances::clear() {
+  instances.clear();
+  dirty = true;
+}
+
+void PropInstances::add(const Instance& instance) {
+  instances.push_back(instance);
+  dirty = true;
+}
+
+void PropInstances::draw(const glm::mat4& view_projection_matrix) {
+  if (instances.empty())
+    return;
+
+  GLState::bind_vertex_array(vao);
+  if (dirty) {
+    GLState::bind_buffer(GL_ARRAY_BUFFER, instance_vbo);
+    size_t bytes = instances.size() * sizeof(Instance);
+    if (instances.size() > uploaded_capacity) {
+      glBufferData(GL_ARRAY_BUFFER, bytes, instances.data(), GL_DYNAMIC_DRAW);
+      uploaded_capacity = instances.size();
+    } else {
+      glBufferSubData(GL_ARRAY_BUFFER, 0, bytes, instances.data());
+    }
+    dirty = false;
+  }
+
+  GLState::set_blend(false);
+  GLState::set_depth_test(true);
+  GLState::depth_mask(true);
+  program.use();
+  ShaderProgram::set(view_projection, view_projection_matrix);
+  ShaderProgram::set(tex, 0);
+  GLState::bind_texture(0, GL_TEXTURE_2D, texture);
+  glDrawElementsInstanced(GL_TRIANGLES, 6, GL_UNSIGNED_INT, 0, (GLsizei)instances.size());
+}
+
+size_t PropInstances::size() const {
+  return instances.size();
+}
@@ -0,0 +1,48 @@
+#pragma once
+#include "shader_program.h"
+#include "glm/mat4x4.hpp"
+#include "glm/vec4.hpp"
+
+#include <glad/glad.h>
+#include <vector>
+
+// Every copy of one kind of track prop (cones, fences, trees), drawn with a
+// single instanced call. The shared mesh is an upright unit quad standing on
+// its bottom edge; each instance places it with its own transform and picks
+// its image from an atlas rect. Props are alpha tested, not blended, and
+// drawn with depth test and writes on, so they need no sorting and hide the
+// sprites drawn after them.
+class PropInstances {
+  public:
+    struct Instance {
+      glm::mat4 transform;
+      // u0, v0, u1, v1 on the atlas page.
+      glm::vec4 atlas_rect;
+    };
+
+  private:
+    ShaderProgram program;
+    ShaderProgram::Uniform<glm::mat4> view_projection;
+    ShaderProgram::Uniform<GLint> tex;
+    GLuint vao;
+    GLuint vbo;
+    GLuint ebo;
+    GLuint instance_vbo;
+    GLuint texture;
+    std::vector<Instance> instances;
+    size_t uploaded_capacity;
+    bool dirty;
+
+  public:
+    explicit PropInstances(GLuint texture);
+    ~PropInstances();
+    PropInstances(const PropInstances&) = delete;
+    PropInstances& operator=(const PropInstances&) = delete;
+
+    void clear();
+    void add(const Instance& instance);
+    // Re-uploads the instance buffer only if instances changed since the
+    // last draw, so static scenery costs nothing per frame.
+    void draw(const glm::mat4& view_projection_matrix);
+    size_t size() const;
+};
@@ -1,10 +1,14 @@
 #include "render.h"
 #include "camera.h"
+#include "gl_state.h"
+#include "gpu_timer.h"
+#include "asset_manager.h"
+#include "perf_overlay.h"
+#include "profiler/frame_stats.h"
+#include "profiler/profiler.h"
 #include "imgui/imgui.h"
 #include "imgui/backends/imgui_impl_glfw.h"
 #include "imgui/backends/imgui_impl_opengl3.h"
-#define STB_IMAGE_IMPLEMENTATION
-#include "stb_image/stb_image.h"
 #include "glad/glad.h"
 #include "glm/mat4x4.hpp"
 #include "glm/vec3.hpp"
@@ -18,10 +22,14 @@
 #include <vector>
 #include <string>
 #include <numeric>
+#include <algorithm>
+#include <cstring>
 #include <iostream>
 
 static float y_translate = -0.01f;
 
+const char* const Renderer::PASS_NAMES[NUM_PASSES] = {"gpu course", "gpu props", "gpu sprites", "gpu imgui"};
+
 void check_compile_errors(GLuint shader, std::string type) {
   GLint success;
   GLchar info_log[1024];
@@ -66,8 +74,14 @@ GLuint Renderer::build_shader_program(GLuint vertex_shader, GLuint fragment_shad
   return program;
 }
 
-void Renderer::setup_shader_attributes(GLuint shader_program, std::vector<Attribute> attributes) {
-  glUseProgram(shader_program);
+Renderer::CourseShader Renderer::make_course_shader(GLuint shader_program) {
+  CourseShader shader{ShaderProgram{shader_program}, {}};
+  shader.mvp = shader.program.uniform<glm::mat4>("mvp");
+  return shader;
+}
+
+void Renderer::setup_shader_attributes(const ShaderProgram& shader_program, const std::vector<Attribute>& attributes) {
+  shader_program.use();
 
   int total = std::accumulate(attributes.begin(), attributes.end(), 0,
       [](int accumulator, const Attribute& attrib) {
@@ -76,53 +90,123 @@ void Renderer::setup_shader_attributes(GLuint shader_program, std::vector<Attrib
 
   int components_offset = 0;
   for (auto& attrib : attributes)  {
-    GLint loc = glGetAttribLocation(shader_program, attrib.name);
-    glEnableVertexAttribArray(loc);
-
+    GLint loc = shader_program.attribute_location(attrib.name);
     GLsizei stride = total*sizeof(attrib.type);
-    const void* offset = (void*)(components_offset*sizeof(attrib.type));
-    components_offset += attrib.num_components;
-    glVertexAttribPointer(loc, attrib.num_components, attrib.type, GL_FALSE, stride, offset);
+    // Matrices take one location per column of up to four components.
+    for (int column = 0; column * 4 < attrib.num_components; column++) {
+      GLint size = std::min(4, attrib.num_components - column * 4);
+      const void* offset = (void*)(components_offset*sizeof(attrib.type));
+      components_offset += size;
+      if (loc < 0)
+        continue;
+      glEnableVertexAttribArray(loc + column);
+      glVertexAttribPointer(loc + column, size, attrib.type, GL_FALSE, stride, offset);
+      glVertexAttribDivisor(loc + column, attrib.divisor);
+    }
   }
 }
 
-GLuint Renderer::load_texture(const std::string& filename) {
-  GLuint tex;
-  glGenTextures(1, &tex);
-  glBindTexture(GL_TEXTURE_2D, tex);
-
-  int width;
-  int height;
-  int num_color_channels;
-  unsigned char* data = stbi_load(filename.c_str(), &width, &height, &num_color_channels, 0);
-  if (data) {
-    glTexImage2D(GL_TEXTURE_2D, 0, GL_RGB, width, height, 0, GL_RGB, GL_UNSIGNED_BYTE, data);
-  } else {
-    std::cout << "Failed to load image.\n";
-    std::cout << stbi_failure_reason();
+namespace {
+  bool has_extension(const char* name) {
+    GLint num_extensions = 0;
+    glGetIntegerv(GL_NUM_EXTENSIONS, &num_extensions);
+    for (GLint i = 0; i < num_extensions; i++) {
+      const char* extension = (const char*)glGetStringi(GL_EXTENSIONS, i);
+      if (extension && std::strcmp(extension, name) == 0)
+        return true;
+    }
+    return false;
   }
-  stbi_image_free(data);
 
+  // Largest anisotropy the driver allows, or 1 if it has no anisotropic
+  // filtering (core in 4.6, an extension before that).
+  float max_anisotropy() {
+    static float max = -1.0f;
+    if (max < 0.0f) {
+      max = 1.0f;
+      if (GLAD_GL_VERSION_4_6 || has_extension("GL_ARB_texture_filter_anisotropic") ||
+          has_extension("GL_EXT_texture_filter_anisotropic"))
+        glGetFloatv(GL_MAX_TEXTURE_MAX_ANISOTROPY, &max);
+    }
+    return max;
+  }
+}
+
+GLuint Renderer::create_texture() {
+  GLuint tex;
+  glGenTextures(1, &tex);
+  GLState::bind_texture(0, GL_TEXTURE_2D, tex);
   glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_S, GL_REPEAT);
   glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_T, GL_REPEAT);
-  glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, GL_NEAREST);
+  return tex;
+}
+
+size_t Renderer::num_upload_levels(const TextureData& data, TextureFilter filter) {
+  if (filter == TextureFilter::NEAREST)
+    return std::min<size_t>(data.levels.size(), 1);
+  return data.levels.size();
+}
+
+void Renderer::upload_texture_level(GLuint texture, const TextureData& data, size_t level) {
+  const MipChain::Level& size = data.levels[level];
+  GLState::bind_texture(0, GL_TEXTURE_2D, texture);
+  glTexImage2D(GL_TEXTURE_2D, (GLint)level, GL_RGBA8, size.width, size.height, 0,
+               GL_RGBA, GL_UNSIGNED_BYTE, data.level_data(level));
+}
+
+void Renderer::set_texture_filter(GLuint texture, size_t num_levels, TextureFilter filter) {
+  GLState::bind_texture(0, GL_TEXTURE_2D, texture);
+  glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAX_LEVEL, num_levels > 0 ? (GLint)num_levels - 1 : 0);
+  // Up close the pixel art stays crisp; only minification is filtered.
   glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAG_FILTER, GL_NEAREST);
+  if (filter == TextureFilter::NEAREST || num_levels <= 1) {
+    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, GL_NEAREST);
+  } else {
+    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, GL_LINEAR_MIPMAP_LINEAR);
+    if (filter == TextureFilter::ANISOTROPIC && max_anisotropy() > 1.0f)
+      glTexParameterf(GL_TEXTURE_2D, GL_TEXTURE_MAX_ANISOTROPY, std::min(8.0f, max_anisotropy()));
+  }
+}
+
+GLuint Renderer::upload_texture(const TextureData& data, TextureFilter filter) {
+  GLuint tex = create_texture();
+  size_t num_levels = num_upload_levels(data, filter);
+  for (size_t i = 0; i < num_levels; i++)
+    upload_texture_level(tex, data, i);
+  set_texture_filter(tex, num_levels, filter);
   return tex;
 }
+
+GLuint Renderer::load_texture(const std::string& filename, TextureFilter filter) {
+  return upload_texture(TextureData::load(filename), filter);
+}
   
 void Renderer::set_vertex_array(GLuint *vao) {
   glGenVertexArrays(1, vao);
-  glBindVertexArray(*vao);
+  GLState::bind_vertex_array(*vao);
 }
 
 void Renderer::set_buffer(GLenum type, GLuint* buffer) {
   glGenBuffers(1, buffer);
-  glBindBuffer(type, *buffer);
+  GLState::bind_buffer(type, *buffer);
 }
 
-void Renderer::render(Camera& camera, GLuint shader_program) {
-  glClearColor(0.0f, 0.2f, 0.4f, 1.0f);
-  glClear(GL_COLOR_BUFFER_BIT);
+void Renderer::render(Camera& camera, const Course& course, Scene& scene) {
+  Profiler::Scope render_zone{"render"};
+  if (scene.gpu_timer) {
+    scene.gpu_timer->begin_frame();
+    // GPU times land LATENCY frames late, in whichever frame reads them.
+    // A frame that reads nothing back has no GPU sample, not a 0 ms one.
+    if (scene.frame_stats) {
+      for (size_t pass = 0; pass < scene.gpu_timer->get_num_passes(); pass++) {
+        const char* name = scene.gpu_timer->get_pass_name(pass);
+        if (scene.gpu_timer->get_has_results())
+          scene.frame_stats->add_time(name, scene.gpu_timer->get_pass_ms(pass));
+        else
+          scene.frame_stats->mark_missing(name);
+      }
+    }
+  }
 
   ImGui_ImplOpenGL3_NewFrame();
   ImGui_ImplGlfw_NewFrame();
@@ -138,15 +222,71 @@ void Renderer::render(Camera& camera, GLuint shader_program) {
   glm::mat4 mat_projection = glm::perspective(glm::radians(45.0f), (float)(aspect_ratio), 0.01f, 100.0f);
   glm::mat4 mvp = mat_projection * mat_view * mat_model;
 
-  GLint mvp_loc = glGetUniformLocation(shader_program, "mvp");
-  glUniformMatrix4fv(mvp_loc, 1, GL_FALSE, &mvp[0][0]);
+  {
+    GpuTimer::Scope gpu_pass{scene.gpu_timer, PASS_COURSE};
+    glClearColor(0.0f, 0.2f, 0.4f, 1.0f);
+    // The sprites leave depth writes off, which would also skip the clear.
+    GLState::depth_mask(true);
+    glClear(GL_COLOR_BUFFER_BIT | GL_DEPTH_BUFFER_BIT);
+    // Everything stands on the course, so it is the backdrop and leaves
+    // the depth buffer to the props and sprites.
+    GLState::set_depth_test(false);
+    course.shader.program.use();
+    GLState::bind_vertex_array(course.vao);
+    GLState::bind_texture(0, GL_TEXTURE_2D, course.texture);
+    ShaderProgram::set(course.shader.mvp, mvp);
 
-  glDrawElements(GL_TRIANGLES, 6, GL_UNSIGNED_INT, 0);
+    glDrawElements(GL_TRIANGLES, 6, GL_UNSIGNED_INT, 0);
+  }
 
+  glm::mat4 view_projection = mat_projection * mat_view;
+  size_t num_props = 0;
+  {
+    GpuTimer::Scope gpu_pass{scene.gpu_timer, PASS_PROPS};
+    for (PropInstances* props : scene.props) {
+      props->draw(view_projection);
+      num_props += props->size();
+    }
+  }
+  SpriteBatch::Stats sprite_stats{};
+  if (scene.sprites) {
+    GpuTimer::Scope gpu_pass{scene.gpu_timer, PASS_SPRITES};
+    scene.sprites->draw(camera, view_projection);
+    sprite_stats = scene.sprites->get_stats();
+  }
+
+  Profiler::Scope imgui_zone{"imgui"};
   ImGui::Text(":)");
   ImGui::Text("%.2f FPS", ImGui::GetIO().Framerate);
   ImGui::SliderFloat("y_translate", &y_translate, -0.3f, 0.3f);
+  ImGui::Text("Props: %zu in %zu instanced draws", num_props, scene.props.size());
+  ImGui::Text("Sprites: %u drawn, %u culled, %u draw calls",
+              sprite_stats.sprites - sprite_stats.culled, sprite_stats.culled, sprite_stats.draw_calls);
+  if (scene.sprites) {
+    const StreamBuffer& stream = scene.sprites->get_vertex_stream();
+    ImGui::Text("Sprite vertex stream: %s, %llu stalls", StreamBuffer::mode_name(stream.get_mode()),
+                (unsigned long long)stream.get_stats().stalls);
+  }
+  GLState::Stats gl_stats = GLState::get_frame_stats();
+  if (scene.assets) {
+    AssetManager::Stats assets = scene.assets->get_stats();
+    ImGui::Text("Textures: %u ready, %u decoding, %u uploading, %u failed; %u levels in %.2f ms",
+                assets.ready, assets.decoding, assets.uploading, assets.failed,
+                assets.levels_uploaded, assets.upload_ms);
+  }
+  ImGui::Text("GL state calls: %llu issued, %llu elided",
+              (unsigned long long)gl_stats.issued, (unsigned long long)gl_stats.elided);
+  ImGui::Text("Heap allocations last frame: %llu; frame arena peak %zu KiB",
+              (unsigned long long)scene.frame_allocations, scene.frame_arena_peak / 1024);
+  if (scene.gpu_timer)
+    ImGui::Text("GPU timer frames dropped: %llu", (unsigned long long)scene.gpu_timer->get_dropped());
+  if (scene.frame_stats)
+    PerfOverlay::draw(*scene.frame_stats);
   ImGui::Render();
-  ImGui_ImplOpenGL3_RenderDrawData(ImGui::GetDrawData());
+  {
+    GpuTimer::Scope gpu_pass{scene.gpu_timer, PASS_IMGUI};
+    ImGui_ImplOpenGL3_RenderDrawData(ImGui::GetDrawData());
+  }
+  GLState::end_frame();
 
 }
@@ -1,20 +1,95 @@
+#pragma once
 #include "camera.h"
+#include "texture_data.h"
+#include "shader_program.h"
+#include "sprite_batch.h"
+#include "prop_instances.h"
+#include "gpu_timer.h"
 
 #include <glad/glad.h>
 #include <GLFW/glfw3.h>
 #include <string>
 #include <vector>
 
+class AssetManager;
+class FrameStats;
+
 namespace Renderer {
   struct Attribute {
     const GLchar* name;
     GLenum type;
     GLint num_components;
+    // 0 advances per vertex, N advances once every N instances.
+    GLuint divisor = 0;
+  };
+
+  // The course program plus its uniform handles, resolved once at startup.
+  struct CourseShader {
+    ShaderProgram program;
+    ShaderProgram::Uniform<glm::mat4> mvp;
   };
 
-  GLuint load_texture(const std::string& filename);
+  CourseShader make_course_shader(GLuint shader_program);
+
+  // What render() times with Scene::gpu_timer, in the order drawn.
+  enum Pass : size_t {
+    PASS_COURSE,
+    PASS_PROPS,
+    PASS_SPRITES,
+    PASS_IMGUI,
+    NUM_PASSES
+  };
+  // Matching names, for GpuTimer and FrameStats.
+  extern const char* const PASS_NAMES[NUM_PASSES];
+
+  // Everything render() needs to draw the ground plane.
+  struct Course {
+    CourseShader shader;
+    GLuint vao;
+    GLuint texture;
+  };
+
+  // What gets drawn on top of the course each frame.
+  struct Scene {
+    std::vector<PropInstances*> props;
+    SpriteBatch* sprites = nullptr;
+    // Only read for the debug overlay.
+    const AssetManager* assets = nullptr;
+    // Heap allocations and frame arena high water mark of the previous
+    // frame, for the overlay.
+    uint64_t frame_allocations = 0;
+    size_t frame_arena_peak = 0;
+    // Drawn as the performance window when set.
+    FrameStats* frame_stats = nullptr;
+    // Times each Pass on the GPU when set, reporting into frame_stats.
+    GpuTimer* gpu_timer = nullptr;
+  };
+
+  enum class TextureFilter {
+    NEAREST,
+    // Mipmapped, blending between the two nearest levels.
+    TRILINEAR,
+    // Trilinear plus up to 8x anisotropic filtering where the driver has it,
+    // which keeps the course sharp at grazing angles.
+    ANISOTROPIC
+  };
+
+  // Generates a texture with REPEAT wrapping and binds it to unit 0.
+  GLuint create_texture();
+  // How many levels of data a texture with filter uses; NEAREST only needs the base.
+  size_t num_upload_levels(const TextureData& data, TextureFilter filter);
+  void upload_texture_level(GLuint texture, const TextureData& data, size_t level);
+  // Call once the first num_levels levels are uploaded.
+  void set_texture_filter(GLuint texture, size_t num_levels, TextureFilter filter);
+
+  // create_texture() + every level + set_texture_filter() in one go.
+  GLuint upload_texture(const TextureData& data, TextureFilter filter = TextureFilter::ANISOTROPIC);
+  // Blocks on TextureData::load; see AssetManager for loading in the background.
+  GLuint load_texture(const std::string& filename, TextureFilter filter = TextureFilter::ANISOTROPIC);
 
-  void setup_shader_attributes(GLuint shader_program, std::vector<Attribute> attributes);
+  // Describes the interleaved layout of the buffer bound to GL_ARRAY_BUFFER.
+  // Call once per buffer, e.g. once for vertices and once for instances.
+  void setup_shader_attributes(const ShaderProgram& shader_program, const std::vector<Attribute>& attributes);
 
   void set_vertex_array(GLuint* vao);
 
@@ -27,7 +102,7 @@ namespace Renderer {
 
   void set_index_buffer(GLuint* elements, size_t size);
 
-  void render(Camera& camera, GLuint shader_program);
+  void render(Camera& camera, const Course& course, Scene& scene);
 
   GLuint compile_shader(const GLchar* shader_source, const std::string& shader_type);
 
@@ -0,0 +1,162 @@
+#include "shader_program.h"
+#include "gl_state.h"
+#include "glm/gtc/type_ptr.hpp"
+
+#include <iostream>
+
+namespace {
+  // Array uniforms are reported as "name[0]"; store them under "name".
+  std::string strip_array_suffix(const GLchar* name, GLsizei length) {
+    std::string s{name, (size_t)length};
+    if (s.size() > 3 && s.compare(s.size() - 3, 3, "[0]") == 0)
+      s.resize(s.size() - 3);
+    return s;
+  }
+
+  bool is_sampler(GLenum type) {
+    switch (type) {
+      case GL_SAMPLER_1D:
+      case GL_SAMPLER_2D:
+      case GL_SAMPLER_3D:
+      case GL_SAMPLER_CUBE:
+      case GL_SAMPLER_2D_ARRAY:
+      case GL_SAMPLER_2D_SHADOW:
+        return true;
+      default:
+        return false;
+    }
+  }
+
+  size_t table_capacity(GLint count) {
+    // Keep the load factor at or below one half.
+    size_t capacity = 4;
+    while (capacity < (size_t)count * 2)
+      capacity *= 2;
+    return capacity;
+  }
+}
+
+ShaderProgram::ShaderProgram(GLuint program) :
+                             program{program} {
+  if (program == 0)
+    return;
+
+  GLint num_uniforms = 0;
+  GLint max_uniform_length = 0;
+  glGetProgramiv(program, GL_ACTIVE_UNIFORMS, &num_uniforms);
+  glGetProgramiv(program, GL_ACTIVE_UNIFORM_MAX_LENGTH, &max_uniform_length);
+  uniforms.resize(table_capacity(num_uniforms));
+  std::vector<GLchar> name(max_uniform_length + 1);
+  for (GLint i = 0; i < num_uniforms; i++) {
+    GLsizei length = 0;
+    Variable var{};
+    glGetActiveUniform(program, i, (GLsizei)name.size(), &length, &var.size, &var.type, name.data());
+    var.location = glGetUniformLocation(program, name.data());
+    insert(uniforms, strip_array_suffix(name.data(), length), var);
+  }
+
+  GLint num_attributes = 0;
+  GLint max_attribute_length = 0;
+  glGetProgramiv(program, GL_ACTIVE_ATTRIBUTES, &num_attributes);
+  glGetProgramiv(program, GL_ACTIVE_ATTRIBUTE_MAX_LENGTH, &max_attribute_length);
+  attributes.resize(table_capacity(num_attributes));
+  name.resize(max_attribute_length + 1);
+  for (GLint i = 0; i < num_attributes; i++) {
+    GLsizei length = 0;
+    Variable var{};
+    glGetActiveAttrib(program, i, (GLsizei)name.size(), &length, &var.size, &var.type, name.data());
+    var.location = glGetAttribLocation(program, name.data());
+    insert(attributes, strip_array_suffix(name.data(), length), var);
+  }
+}
+
+uint32_t ShaderProgram::hash_name(const char* name) {
+  // FNV-1a
+  uint32_t hash = 2166136261u;
+  for (; *name; name++) {
+    hash ^= (unsigned char)*name;
+    hash *= 16777619u;
+  }
+  return hash;
+}
+
+void ShaderProgram::insert(std::vector<Entry>& table, const std::string& name, const Variable& var) {
+  uint32_t hash = hash_name(name.c_str());
+  size_t mask = table.size() - 1;
+  size_t i = hash & mask;
+  while (!table[i].name.empty())
+    i = (i + 1) & mask;
+  table[i].hash = hash;
+  table[i].name = name;
+  table[i].var = var;
+}
+
+const ShaderProgram::Variable* ShaderProgram::find(const std::vector<Entry>& table, const char* name) {
+  if (table.empty())
+    return nullptr;
+  uint32_t hash = hash_name(name);
+  size_t mask = table.size() - 1;
+  for (size_t i = hash & mask; !table[i].name.empty(); i = (i + 1) & mask) {
+    if (table[i].hash == hash && table[i].name == name)
+      return &table[i].var;
+  }
+  return nullptr;
+}
+
+bool ShaderProgram::check_uniform_type(const char* name, const Variable* var, GLenum expected) const {
+  if (!var) {
+    std::cout << "Uniform \"" << name << "\" is not active in program " << program << "\n";
+    return false;
+  }
+  if (var->type != expected && !(expected == GL_INT && is_sampler(var->type))) {
+    std::cout << "Uniform \"" << name << "\" has type 0x" << std::hex << var->type
+              << ", expected 0x" << expected << std::dec << "\n";
+    return false;
+  }
+  return true;
+}
+
+GLuint ShaderProgram::get_id() const {
+  return program;
+}
+
+void ShaderProgram::use() const {
+  GLState::use_program(program);
+}
+
+const ShaderProgram::Variable* ShaderProgram::find_uniform(const char* name) const {
+  return find(uniforms, name);
+}
+
+const ShaderProgram::Variable* ShaderProgram::find_attribute(const char* name) const {
+  return find(attributes, name);
+}
+
+GLint ShaderProgram::attribute_location(const char* name) const {
+  const Variable* var = find_attribute(name);
+  return var ? var->location : -1;
+}
+
+void ShaderProgram::set(Uniform<GLint> u, GLint value) {
+  glUniform1i(u.location, value);
+}
+
+void ShaderProgram::set(Uniform<GLfloat> u, GLfloat value) {
+  glUniform1f(u.location, value);
+}
+
+void ShaderProgram::set(Uniform<glm::vec2> u, const glm::vec2& value) {
+  glUniform2fv(u.location, 1, glm::value_ptr(value));
+}
+
+void ShaderProgram::set(Uniform<glm::vec3> u, const glm::vec3& value) {
+  glUniform3fv(u.location, 1, glm::value_ptr(value));
+}
+
+void ShaderProgram::set(Uniform<glm::vec4> u, const glm::vec4& value) {
+  glUniform4fv(u.location, 1, glm::value_ptr(value));
+}
+
+void ShaderProgram::set(Uniform<glm::mat4> u, const glm::mat4& value) {
+  glUniformMatrix4fv(u.location, 1, GL_FALSE, glm::value_ptr(value));
+}
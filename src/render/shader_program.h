@@ -0,0 +1,85 @@
+#pragma once
+#include "glm/mat4x4.hpp"
+#include "glm/vec2.hpp"
+#include "glm/vec3.hpp"
+#include "glm/vec4.hpp"
+
+#include <glad/glad.h>
+#include <cstdint>
+#include <string>
+#include <vector>
+
+// Wraps a linked program and reflects every active uniform and attribute
+// once, up front. Lookups by name only touch our own table; the render loop
+// holds typed handles and never asks the driver for a location.
+class ShaderProgram {
+  public:
+    struct Variable {
+      GLint location = -1;
+      GLenum type = 0;
+      GLint size = 0;
+    };
+
+    template <typename T>
+    struct Uniform {
+      GLint location = -1;
+      bool is_valid() const { return location >= 0; }
+    };
+
+  private:
+    // Open addressing with linear probing, capacity is a power of two.
+    struct Entry {
+      uint32_t hash = 0;
+      std::string name{};
+      Variable var{};
+    };
+
+    GLuint program;
+    std::vector<Entry> uniforms;
+    std::vector<Entry> attributes;
+
+    static uint32_t hash_name(const char* name);
+    static void insert(std::vector<Entry>& table, const std::string& name, const Variable& var);
+    static const Variable* find(const std::vector<Entry>& table, const char* name);
+    bool check_uniform_type(const char* name, const Variable* var, GLenum expected) const;
+
+  public:
+    explicit ShaderProgram(GLuint program = 0);
+    GLuint get_id() const;
+    void use() const;
+
+    const Variable* find_uniform(const char* name) const;
+    const Variable* find_attribute(const char* name) const;
+    GLint attribute_location(const char* name) const;
+
+    // Resolves a handle and checks the declared GLSL type matches T.
+    // Missing or mismatched uniforms give an invalid handle, which GL ignores.
+    template <typename T>
+    Uniform<T> uniform(const char* name) const;
+
+    static void set(Uniform<GLint> u, GLint value);
+    static void set(Uniform<GLfloat> u, GLfloat value);
+    static void set(Uniform<glm::vec2> u, const glm::vec2& value);
+    static void set(Uniform<glm::vec3> u, const glm::vec3& value);
+    static void set(Uniform<glm::vec4> u, const glm::vec4& value);
+    static void set(Uniform<glm::mat4> u, const glm::mat4& value);
+};
+
+template <typename T>
+struct UniformType;
+
+template <> struct UniformType<GLint> { static constexpr GLenum value = GL_INT; };
+template <> struct UniformType<GLfloat> { static constexpr GLenum value = GL_FLOAT; };
+template <> struct UniformType<glm::vec2> { static constexpr GLenum value = GL_FLOAT_VEC2; };
+template <> struct UniformType<glm::vec3> { static constexpr GLenum value = GL_FLOAT_VEC3; };
+template <> struct UniformType<glm::vec4> { static constexpr GLenum value = GL_FLOAT_VEC4; };
+template <> struct UniformType<glm::mat4> { static constexpr GLenum value = GL_FLOAT_MAT4; };
+
+template <typename T>
+ShaderProgram::Uniform<T> ShaderProgram::uniform(const char* name) const {
+  const Variable* var = find_uniform(name);
+  Uniform<T> handle{};
+  if (check_uniform_type(name, var, UniformType<T>::value))
+    handle.location = var->location;
+  return handle;
+}
@@ -0,0 +1,422 @@
+#include "soft_render.h"
+#include "camera.h"
+#include "jobs/job_system.h"
+#include "glm/vec3.hpp"
+#include "glm/trigonometric.hpp"
+
+#include <algorithm>
+#include <cmath>
+#include <cstdio>
+#include <iostream>
+
+#if defined(__GNUC__) && (defined(__x86_64__) || defined(__i386__))
+#define SOFT_RENDER_X86
+#include <immintrin.h>
+#endif
+
+namespace {
+  // Texture coordinates are stepped along a scanline in 16.16 fixed point.
+  const int FIXED_SHIFT = 16;
+  const double FIXED_ONE = 65536.0;
+
+  int32_t to_fixed(double x) {
+    return (int32_t)std::lround(std::clamp(x * FIXED_ONE, -1073741824.0, 1073741823.0));
+  }
+
+  struct TexelLevel {
+    const uint32_t* texels;
+    int width;
+    int height;
+  };
+
+  struct Span {
+    uint32_t* dst;
+    int count;
+    int32_t u;
+    int32_t v;
+    int32_t du;
+    int32_t dv;
+  };
+
+  void span_scalar(const Span& span, const TexelLevel& tex) {
+    const uint32_t* texels = tex.texels;
+    int32_t u = span.u;
+    int32_t v = span.v;
+    for (int i = 0; i < span.count; i++) {
+      int tu = std::clamp(u >> FIXED_SHIFT, 0, tex.width - 1);
+      int tv = std::clamp(v >> FIXED_SHIFT, 0, tex.height - 1);
+      span.dst[i] = texels[tv * tex.width + tu];
+      u += span.du;
+      v += span.dv;
+    }
+  }
+
+#ifdef SOFT_RENDER_X86
+  __attribute__((target("sse4.1")))
+  void span_sse41(const Span& span, const TexelLevel& tex) {
+    const uint32_t* texels = tex.texels;
+    const __m128i lane = _mm_setr_epi32(0, 1, 2, 3);
+    const __m128i max_u = _mm_set1_epi32(tex.width - 1);
+    const __m128i max_v = _mm_set1_epi32(tex.height - 1);
+    const __m128i zero = _mm_setzero_si128();
+    const __m128i pitch = _mm_set1_epi32(tex.width);
+    const __m128i step_u = _mm_set1_epi32((int32_t)((uint32_t)span.du * 4));
+    const __m128i step_v = _mm_set1_epi32((int32_t)((uint32_t)span.dv * 4));
+    __m128i u = _mm_add_epi32(_mm_set1_epi32(span.u), _mm_mullo_epi32(lane, _mm_set1_epi32(span.du)));
+    __m128i v = _mm_add_epi32(_mm_set1_epi32(span.v), _mm_mullo_epi32(lane, _mm_set1_epi32(span.dv)));
+
+    int i = 0;
+    alignas(16) int32_t idx[4];
+    for (; i + 4 <= span.count; i += 4) {
+      __m128i tu = _mm_min_epi32(_mm_max_epi32(_mm_srai_epi32(u, FIXED_SHIFT), zero), max_u);
+      __m128i tv = _mm_min_epi32(_mm_max_epi32(_mm_srai_epi32(v, FIXED_SHIFT), zero), max_v);
+      _mm_store_si128((__m128i*)idx, _mm_add_epi32(_mm_mullo_epi32(tv, pitch), tu));
+      __m128i px = _mm_setr_epi32(texels[idx[0]], texels[idx[1]], texels[idx[2]], texels[idx[3]]);
+      _mm_storeu_si128((__m128i*)(span.dst + i), px);
+      u = _mm_add_epi32(u, step_u);
+      v = _mm_add_epi32(v, step_v);
+    }
+
+    Span tail = span;
+    tail.dst += i;
+    tail.count -= i;
+    tail.u += span.du * i;
+    tail.v += span.dv * i;
+    span_scalar(tail, tex);
+  }
+
+  __attribute__((target("avx2")))
+  void span_avx2(const Span& span, const TexelLevel& tex) {
+    const int* texels = (const int*)tex.texels;
+    const __m256i lane = _mm256_setr_epi32(0, 1, 2, 3, 4, 5, 6, 7);
+    const __m256i max_u = _mm256_set1_epi32(tex.width - 1);
+    const __m256i max_v = _mm256_set1_epi32(tex.height - 1);
+    const __m256i zero = _mm256_setzero_si256();
+    const __m256i pitch = _mm256_set1_epi32(tex.width);
+    const __m256i step_u = _mm256_set1_epi32((int32_t)((uint32_t)span.du * 8));
+    const __m256i step_v = _mm256_set1_epi32((int32_t)((uint32_t)span.dv * 8));
+    __m256i u = _mm256_add_epi32(_mm256_set1_epi32(span.u), _mm256_mullo_epi32(lane, _mm256_set1_epi32(span.du)));
+    __m256i v = _mm256_add_epi32(_mm256_set1_epi32(span.v), _mm256_mullo_epi32(lane, _mm256_set1_epi32(span.dv)));
+
+    int i = 0;
+    for (; i + 8 <= span.count; i += 8) {
+      __m256i tu = _mm256_min_epi32(_mm256_max_epi32(_mm256_srai_epi32(u, FIXED_SHIFT), zero), max_u);
+      __m256i tv = _mm256_min_epi32(_mm256_max_epi32(_mm256_srai_epi32(v, FIXED_SHIFT), zero), max_v);
+      __m256i idx = _mm256_add_epi32(_mm256_mullo_epi32(tv, pitch), tu);
+      __m256i px = _mm256_i32gather_epi32(texels, idx, 4);
+      _mm256_storeu_si256((__m256i*)(span.dst + i), px);
+      u = _mm256_add_epi32(u, step_u);
+      v = _mm256_add_epi32(v, step_v);
+    }
+
+    Span tail = span;
+    tail.dst += i;
+    tail.count -= i;
+    tail.u += span.du * i;
+    tail.v += span.dv * i;
+    span_scalar(tail, tex);
+  }
+#endif
+
+  void draw_span(SoftRenderer::Kernel kernel, const Span& span, const TexelLevel& tex) {
+    switch (kernel) {
+#ifdef SOFT_RENDER_X86
+      case SoftRenderer::Kernel::AVX2:
+        span_avx2(span, tex);
+        return;
+      case SoftRenderer::Kernel::SSE41:
+        span_sse41(span, tex);
+        return;
+#endif
+      default:
+        span_scalar(span, tex);
+        return;
+    }
+  }
+
+  // Narrows [lo, hi] to the pixels x for which 0 <= a + b*x < limit.
+  void clip_interval(double a, double b, double limit, double& lo, double& hi) {
+    if (b == 0.0) {
+      if (a < 0.0 || a >= limit) {
+        lo = 1.0;
+        hi = 0.0;
+      }
+      return;
+    }
+    double x0 = (0.0 - a) / b;
+    double x1 = (limit - a) / b;
+    lo = std::max(lo, std::min(x0, x1));
+    hi = std::min(hi, std::max(x0, x1));
+  }
+
+  // Per-frame constants for projecting scanlines onto the plane.
+  struct RowSetup {
+    glm::dvec3 eye;
+    glm::dvec3 front;
+    glm::dvec3 up;
+    glm::dvec3 right;
+    double tan_half;
+    double height_above;
+    // Camera-space x of the first pixel centre, and the step between pixels.
+    double rx0;
+    double drx;
+    double plane_min_x;
+    double plane_max_z;
+    double texels_per_unit_u;
+    double texels_per_unit_v;
+    double near_plane;
+    double far_plane;
+    int width;
+    int height;
+    int tex_width;
+    int tex_height;
+    int num_levels;
+  };
+
+  // The visible run of one row, in base level texel coordinates, and the
+  // mip level it samples from.
+  struct RowSpan {
+    int x_begin;
+    int x_end;
+    double u;
+    double v;
+    double du;
+    double dv;
+    int level;
+  };
+
+  RowSetup make_row_setup(const Camera& camera, const SoftRenderer::Texture& texture, int width, int height,
+                          const SoftRenderer::GroundPlane& plane, const SoftRenderer::Projection& projection) {
+    RowSetup setup{};
+    setup.eye = camera.get_position();
+    setup.front = camera.get_front();
+    setup.up = camera.get_up();
+    setup.right = camera.get_right();
+    setup.tan_half = std::tan(glm::radians(projection.fov_y_degrees) * 0.5);
+    double aspect = (double)width / height;
+    setup.height_above = plane.height - setup.eye.y;
+    setup.rx0 = (-1.0 + 1.0 / width) * setup.tan_half * aspect;
+    setup.drx = 2.0 / width * setup.tan_half * aspect;
+    setup.plane_min_x = plane.center_x - plane.size * 0.5;
+    setup.plane_max_z = plane.center_z + plane.size * 0.5;
+    setup.texels_per_unit_u = texture.width / plane.size;
+    setup.texels_per_unit_v = texture.height / plane.size;
+    setup.near_plane = projection.near_plane;
+    setup.far_plane = projection.far_plane;
+    setup.width = width;
+    setup.height = height;
+    setup.tex_width = texture.width;
+    setup.tex_height = texture.height;
+    setup.num_levels = projection.mipmaps ? (int)texture.levels.size() : 1;
+    return setup;
+  }
+
+  // Texel coordinates where row y meets the plane at camera-space x = rx.
+  bool hit_plane(const RowSetup& setup, double y, double rx, double& u, double& v) {
+    double ry = (1.0 - 2.0 * (y + 0.5) / setup.height) * setup.tan_half;
+    glm::dvec3 dir = setup.front + setup.up * ry;
+    if (dir.y == 0.0)
+      return false;
+    double depth = setup.height_above / dir.y;
+    if (depth < setup.near_plane || depth > setup.far_plane)
+      return false;
+    glm::dvec3 p = setup.eye + depth * (dir + setup.right * rx);
+    u = (p.x - setup.plane_min_x) * setup.texels_per_unit_u;
+    v = (setup.plane_max_z - p.z) * setup.texels_per_unit_v;
+    return true;
+  }
+
+  bool project_row(const RowSetup& setup, int y, RowSpan& row) {
+    // The camera never rolls, so right.y is zero and every pixel in the row
+    // hits the plane at the same depth: the texel position is linear in x.
+    double u1;
+    double v1;
+    if (!hit_plane(setup, y, setup.rx0, row.u, row.v) ||
+        !hit_plane(setup, y, setup.rx0 + setup.drx, u1, v1))
+      return false;
+    row.du = u1 - row.u;
+    row.dv = v1 - row.v;
+
+    double lo = 0.0;
+    double hi = setup.width - 1;
+    clip_interval(row.u, row.du, setup.tex_width, lo, hi);
+    clip_interval(row.v, row.dv, setup.tex_height, lo, hi);
+    row.x_begin = (int)std::ceil(lo);
+    row.x_end = (int)std::floor(hi) + 1;
+    if (row.x_end <= row.x_begin)
+      return false;
+
+    // Pick the level the way a GPU would: from the larger of the texel
+    // footprints along the row and down to the next row.
+    double rho = std::hypot(row.du, row.dv);
+    double center_rx = setup.rx0 + setup.drx * (setup.width / 2);
+    double uc0, vc0, uc1, vc1;
+    if (hit_plane(setup, y, center_rx, uc0, vc0) && hit_plane(setup, y + 1, center_rx, uc1, vc1))
+      rho = std::max(rho, std::hypot(uc1 - uc0, vc1 - vc0));
+    row.level = 0;
+    if (rho > 1.0)
+      row.level = std::min((int)std::log2(rho), setup.num_levels - 1);
+    return true;
+  }
+}
+
+int SoftRenderer::Framebuffer::row_granularity() const {
+  // Smallest number of rows whose byte size is a whole number of cache lines.
+  int rows = 1;
+  while ((rows * width * (int)sizeof(uint32_t)) % CACHE_LINE != 0 && rows < CACHE_LINE)
+    rows++;
+  return rows;
+}
+
+SoftRenderer::Framebuffer::Framebuffer(int width, int height) :
+                                       width{width},
+                                       height{height},
+                                       pixels(width * height) {
+}
+
+SoftRenderer::Kernel SoftRenderer::best_kernel() {
+#ifdef SOFT_RENDER_X86
+  if (__builtin_cpu_supports("avx2"))
+    return Kernel::AVX2;
+  if (__builtin_cpu_supports("sse4.1"))
+    return Kernel::SSE41;
+#endif
+  return Kernel::SCALAR;
+}
+
+const char* SoftRenderer::kernel_name(Kernel kernel) {
+  switch (kernel) {
+    case Kernel::AVX2:
+      return "avx2";
+    case Kernel::SSE41:
+      return "sse4.1";
+    default:
+      return "scalar";
+  }
+}
+
+SoftRenderer::Texture SoftRenderer::load_texture(const std::string& filename) {
+  return TextureData::load(filename);
+}
+
+void SoftRenderer::render(const Camera& camera, const Texture& texture, Framebuffer& fb,
+                          const GroundPlane& plane, const Projection& projection,
+                          Kernel kernel) {
+  render_rows(camera, texture, fb, plane, projection, kernel, 0, fb.height);
+}
+
+void SoftRenderer::render_rows(const Camera& camera, const Texture& texture, Framebuffer& fb,
+                               const GroundPlane& plane, const Projection& projection,
+                               Kernel kernel, int row_begin, int row_end) {
+  std::fill(fb.pixels.begin() + row_begin * fb.width, fb.pixels.begin() + row_end * fb.width,
+            projection.clear_color);
+  if (texture.levels.empty())
+    return;
+
+  RowSetup setup = make_row_setup(camera, texture, fb.width, fb.height, plane, projection);
+  for (int y = row_begin; y < row_end; y++) {
+    RowSpan row;
+    if (!project_row(setup, y, row))
+      continue;
+
+    const MipChain::Level& level = texture.levels[row.level];
+    double scale_u = (double)level.width / texture.width;
+    double scale_v = (double)level.height / texture.height;
+    TexelLevel tex{texture.level_data(row.level), level.width, level.height};
+
+    Span span{};
+    span.dst = fb.pixels.data() + y * fb.width + row.x_begin;
+    span.count = row.x_end - row.x_begin;
+    span.u = to_fixed((row.u + row.du * row.x_begin) * scale_u);
+    span.v = to_fixed((row.v + row.dv * row.x_begin) * scale_v);
+    span.du = to_fixed(row.du * scale_u);
+    span.dv = to_fixed(row.dv * scale_v);
+    draw_span(kernel, span, tex);
+  }
+}
+
+SoftRenderer::TexelStats SoftRenderer::measure_texels(const Camera& camera, const Texture& texture,
+                                                      int width, int height,
+                                                      const GroundPlane& plane, const Projection& projection) {
+  TexelStats stats{};
+  if (texture.levels.empty())
+    return stats;
+
+  const size_t texels_per_line = CACHE_LINE / sizeof(uint32_t);
+  std::vector<bool> texel_seen(texture.num_texels());
+  std::vector<bool> line_seen(texture.num_texels() / texels_per_line + 1);
+  RowSetup setup = make_row_setup(camera, texture, width, height, plane, projection);
+  for (int y = 0; y < height; y++) {
+    RowSpan row;
+    if (!project_row(setup, y, row))
+      continue;
+    const MipChain::Level& level = texture.levels[row.level];
+    double scale_u = (double)level.width / texture.width;
+    double scale_v = (double)level.height / texture.height;
+    for (int x = row.x_begin; x < row.x_end; x++) {
+      int tu = std::clamp((int)((row.u + row.du * x) * scale_u), 0, level.width - 1);
+      int tv = std::clamp((int)((row.v + row.dv * x) * scale_v), 0, level.height - 1);
+      size_t index = level.offset + (size_t)tv * level.width + tu;
+      stats.texels_fetched++;
+      if (!texel_seen[index]) {
+        texel_seen[index] = true;
+        stats.distinct_texels++;
+      }
+      if (!line_seen[index / texels_per_line]) {
+        line_seen[index / texels_per_line] = true;
+        stats.distinct_cache_lines++;
+      }
+    }
+  }
+  return stats;
+}
+
+SoftRenderer::BandRenderer::BandRenderer(JobSystem& jobs) :
+                                          jobs{jobs} {
+}
+
+void SoftRenderer::BandRenderer::render(const Camera& camera, const Texture& texture, Framebuffer& fb,
+                                        const GroundPlane& plane, const Projection& projection,
+                                        Kernel kernel) {
+  // Aim for a few bands per thread, rounded to whole cache lines of rows.
+  // Sky bands are cheap and ground bands expensive; idle threads steal the
+  // difference.
+  int granularity = fb.row_granularity();
+  int target_bands = get_num_threads() * 4;
+  int band_height = (fb.height + target_bands - 1) / target_bands;
+  band_height = std::max(granularity, (band_height + granularity - 1) / granularity * granularity);
+  int num_bands = (fb.height + band_height - 1) / band_height;
+
+  jobs.parallel_for((size_t)num_bands, 1, [&](size_t begin, size_t end) {
+    for (size_t band = begin; band < end; band++) {
+      int row_begin = (int)band * band_height;
+      int row_end = std::min(row_begin + band_height, fb.height);
+      render_rows(camera, texture, fb, plane, projection, kernel, row_begin, row_end);
+    }
+  });
+}
+
+int SoftRenderer::BandRenderer::get_num_threads() const {
+  return jobs.get_num_threads();
+}
+
+bool SoftRenderer::write_ppm(const Framebuffer& fb, const std::string& filename) {
+  FILE* f = std::fopen(filename.c_str(), "wb");
+  if (!f) {
+    std::cout << "Failed to open " << filename << " for writing.\n";
+    return false;
+  }
+  std::fprintf(f, "P6\n%d %d\n255\n", fb.width, fb.height);
+  std::vector<unsigned char> row(fb.width * 3);
+  for (int y = 0; y < fb.height; y++) {
+    for (int x = 0; x < fb.width; x++) {
+      uint32_t px = fb.pixels[y * fb.width + x];
+      row[x * 3 + 0] = px & 0xff;
+      row[x * 3 + 1] = (px >> 8) & 0xff;
+      row[x * 3 + 2] = (px >> 16) & 0xff;
+    }
+    std::fwrite(row.data(), 1, row.size(), f);
+  }
+  std::fclose(f);
+  return true;
+}
@@ -0,0 +1,117 @@
+#pragma once
+#include "camera.h"
+#include "texture_data.h"
+
+#include <cstddef>
+#include <cstdint>
+#include <new>
+#include <string>
+#include <vector>
+
+class JobSystem;
+
+// CPU Mode-7 renderer for the course plane. Produces the same image as the
+// textured quad drawn by Renderer::render, without needing a GL context.
+namespace SoftRenderer {
+  constexpr int CACHE_LINE = 64;
+
+  // Keeps framebuffer rows on cache line boundaries so bands rendered by
+  // different threads never write to the same line.
+  template <typename T>
+  struct CacheAlignedAllocator {
+    using value_type = T;
+    CacheAlignedAllocator() = default;
+    template <typename U>
+    CacheAlignedAllocator(const CacheAlignedAllocator<U>&) {}
+    T* allocate(size_t n) {
+      return (T*)::operator new(n * sizeof(T), std::align_val_t(CACHE_LINE));
+    }
+    void deallocate(T* p, size_t) {
+      ::operator delete(p, std::align_val_t(CACHE_LINE));
+    }
+    template <typename U>
+    bool operator==(const CacheAlignedAllocator<U>&) const { return true; }
+    template <typename U>
+    bool operator!=(const CacheAlignedAllocator<U>&) const { return false; }
+  };
+
+  // Texels and pixels are packed RGBA8, red in the lowest byte.
+  using Texture = TextureData;
+
+  struct Framebuffer {
+    int width;
+    int height;
+    std::vector<uint32_t, CacheAlignedAllocator<uint32_t>> pixels;
+    Framebuffer(int width, int height);
+    // Band heights must be a multiple of this to avoid false sharing.
+    int row_granularity() const;
+  };
+
+  // Horizontal textured square, defaults match the quad's model matrix.
+  struct GroundPlane {
+    float height = -0.01f;
+    float center_x = 0.0f;
+    float center_z = -0.3f;
+    float size = 1.0f;
+  };
+
+  struct Projection {
+    float fov_y_degrees = 45.0f;
+    float near_plane = 0.01f;
+    float far_plane = 100.0f;
+    uint32_t clear_color = 0xff663300;
+    // Sample each row from the mip level matching its texel footprint.
+    bool mipmaps = true;
+  };
+
+  // Texture traffic for one frame: every fetch, and how many distinct
+  // texels and 64-byte lines those fetches touched.
+  struct TexelStats {
+    uint64_t texels_fetched = 0;
+    uint64_t distinct_texels = 0;
+    uint64_t distinct_cache_lines = 0;
+  };
+
+  enum class Kernel {
+    SCALAR,
+    SSE41,
+    AVX2
+  };
+
+  // Fastest scanline kernel the running CPU supports.
+  Kernel best_kernel();
+
+  const char* kernel_name(Kernel kernel);
+
+  // Maps .ktex files from texbake in place; decodes and mipmaps anything else.
+  Texture load_texture(const std::string& filename);
+
+  void render(const Camera& camera, const Texture& texture, Framebuffer& fb,
+              const GroundPlane& plane = {}, const Projection& projection = {},
+              Kernel kernel = best_kernel());
+
+  // Renders only rows [row_begin, row_end), safe to call concurrently on
+  // disjoint ranges of the same framebuffer.
+  void render_rows(const Camera& camera, const Texture& texture, Framebuffer& fb,
+                   const GroundPlane& plane, const Projection& projection,
+                   Kernel kernel, int row_begin, int row_end);
+
+  // Splits the frame into horizontal bands and renders them as jobs. The
+  // calling thread renders bands too.
+  class BandRenderer {
+    JobSystem& jobs;
+    public:
+      explicit BandRenderer(JobSystem& jobs);
+      void render(const Camera& camera, const Texture& texture, Framebuffer& fb,
+                  const GroundPlane& plane = {}, const Projection& projection = {},
+                  Kernel kernel = best_kernel());
+      int get_num_threads() const;
+  };
+
+  // Replays a frame's texel fetches without drawing, for comparing cache
+  // footprints with and without mipmaps.
+  TexelStats measure_texels(const Camera& camera, const Texture& texture, int width, int height,
+                            const GroundPlane& plane = {}, const Projection& projection = {});
+
+  bool write_ppm(const Framebuffer& fb, const std::string& filename);
+}
@@ -0,0 +1,214 @@
+#include "sprite_batch.h"
+#include "render.h"
+#include "gl_state.h"
+#include "glm/geometric.hpp"
+
+#include <algorithm>
+#include <cstddef>
+#include <cstring>
+
+namespace {
+  const float NEAR_PLANE = 0.01f;
+
+  uint32_t depth_key(float depth) {
+    uint32_t bits;
+    std::memcpy(&bits, &depth, sizeof(bits));
+    // Depth is positive after culling, so its bit pattern orders like the value.
+    return ~bits;
+  }
+}
+
+SpriteBatch::SpriteBatch(size_t initial_capacity) :
+                         vao{0},
+                         vertex_stream{GL_ARRAY_BUFFER, initial_capacity * 4 * sizeof(Vertex)},
+                         ebo{0},
+                         white_texture{0},
+                         index_capacity{0},
+                         stats{} {
+  const GLchar* vert_shader_source =
+    #include "shaders/sprite_vert.glsl"
+    ;
+  const GLchar* frag_shader_source =
+    #include "shaders/sprite_frag.glsl"
+    ;
+  GLuint vert_shader = Renderer::compile_shader(vert_shader_source, "VERTEX");
+  GLuint frag_shader = Renderer::compile_shader(frag_shader_source, "FRAGMENT");
+  program = ShaderProgram{Renderer::build_shader_program(vert_shader, frag_shader)};
+  glDeleteShader(vert_shader);
+  glDeleteShader(frag_shader);
+  view_projection = program.uniform<glm::mat4>("view_projection");
+  tex = program.uniform<GLint>("tex");
+
+  Renderer::set_vertex_array(&vao);
+  Renderer::set_buffer(GL_ELEMENT_ARRAY_BUFFER, &ebo);
+  setup_vertex_attributes();
+  reserve_indices(initial_capacity);
+
+  uint32_t white = 0xffffffff;
+  glGenTextures(1, &white_texture);
+  GLState::bind_texture(0, GL_TEXTURE_2D, white_texture);
+  glTexImage2D(GL_TEXTURE_2D, 0, GL_RGBA, 1, 1, 0, GL_RGBA, GL_UNSIGNED_BYTE, &white);
+  glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, GL_NEAREST);
+  glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAG_FILTER, GL_NEAREST);
+
+  sprites.reserve(initial_capacity);
+  order.reserve(initial_capacity);
+}
+
+SpriteBatch::~SpriteBatch() {
+  GLState::delete_texture(white_texture);
+  GLState::delete_buffer(ebo);
+  GLState::delete_vertex_array(vao);
+  GLState::delete_program(program.get_id());
+}
+
+void SpriteBatch::reserve_indices(size_t num_sprites) {
+  if (num_sprites <= index_capacity)
+    return;
+  size_t capacity = std::max<size_t>(index_capacity * 2, num_sprites);
+  // The quad pattern never changes, so the index buffer is only rebuilt
+  // when it has to grow.
+  std::vector<GLuint> indices(capacity * 6);
+  for (size_t i = 0; i < capacity; i++) {
+    GLuint base = (GLuint)(i * 4);
+    GLuint* quad = &indices[i * 6];
+    quad[0] = base + 0;
+    quad[1] = base + 1;
+    quad[2] = base + 2;
+    quad[3] = base + 2;
+    quad[4] = base + 3;
+    quad[5] = base + 0;
+  }
+  GLState::bind_vertex_array(vao);
+  GLState::bind_buffer(GL_ELEMENT_ARRAY_BUFFER, ebo);
+  glBufferData(GL_ELEMENT_ARRAY_BUFFER, indices.size() * sizeof(GLuint), indices.data(), GL_STATIC_DRAW);
+  index_capacity = capacity;
+}
+
+void SpriteBatch::setup_vertex_attributes() {
+  GLState::bind_vertex_array(vao);
+  GLState::bind_buffer(GL_ARRAY_BUFFER, vertex_stream.get_buffer());
+  GLint pos_loc = program.attribute_location("pos");
+  GLint texcoord_loc = program.attribute_location("texcoord");
+  GLint color_loc = program.attribute_location("color");
+  glEnableVertexAttribArray(pos_loc);
+  glVertexAttribPointer(pos_loc, 3, GL_FLOAT, GL_FALSE, sizeof(Vertex), (void*)offsetof(Vertex, pos));
+  glEnableVertexAttribArray(texcoord_loc);
+  glVertexAttribPointer(texcoord_loc, 2, GL_FLOAT, GL_FALSE, sizeof(Vertex), (void*)offsetof(Vertex, texcoord));
+  glEnableVertexAttribArray(color_loc);
+  glVertexAttribPointer(color_loc, 4, GL_UNSIGNED_BYTE, GL_TRUE, sizeof(Vertex), (void*)offsetof(Vertex, color));
+}
+
+void SpriteBatch::clear() {
+  sprites.clear();
+}
+
+void SpriteBatch::add(const Sprite& sprite) {
+  sprites.push_back(sprite);
+}
+
+void SpriteBatch::draw(const Camera& camera, const glm::mat4& view_projection_matrix,
+                       SortMode sort_mode) {
+  stats = Stats{};
+  stats.sprites = (uint32_t)sprites.size();
+  if (sprites.empty())
+    return;
+
+  stats.culled = sort(sprites, camera, sort_mode, order);
+  if (order.empty())
+    return;
+
+  size_t bytes = order.size() * 4 * sizeof(Vertex);
+  if (vertex_stream.reserve(bytes))
+    setup_vertex_attributes();
+  size_t offset;
+  Vertex* v = (Vertex*)vertex_stream.map(bytes, sizeof(Vertex), offset);
+  if (!v) {
+    vertex_stream.end_frame();
+    return;
+  }
+  write_vertices(sprites, order, camera, v);
+  vertex_stream.unmap();
+  GLint base_vertex = (GLint)(offset / sizeof(Vertex));
+
+  reserve_indices(order.size());
+  program.use();
+  ShaderProgram::set(view_projection, view_projection_matrix);
+  ShaderProgram::set(tex, 0);
+  GLState::bind_vertex_array(vao);
+  GLState::set_blend(true);
+  GLState::blend_func(GL_SRC_ALPHA, GL_ONE_MINUS_SRC_ALPHA);
+  // Hidden behind props, which write depth; blended, so sorted among
+  // themselves instead of writing it.
+  GLState::set_depth_test(true);
+  GLState::depth_mask(false);
+
+  size_t run_start = 0;
+  for (size_t i = 1; i <= order.size(); i++) {
+    GLuint texture = sprites[order[run_start].index].texture;
+    if (i < order.size() && sprites[order[i].index].texture == texture)
+      continue;
+    GLState::bind_texture(0, GL_TEXTURE_2D, texture ? texture : white_texture);
+    glDrawElementsBaseVertex(GL_TRIANGLES, (GLsizei)((i - run_start) * 6), GL_UNSIGNED_INT,
+                             (void*)(run_start * 6 * sizeof(GLuint)), base_vertex);
+    stats.draw_calls++;
+    run_start = i;
+  }
+  vertex_stream.end_frame();
+}
+
+uint32_t SpriteBatch::sort(const std::vector<Sprite>& sprites, const Camera& camera, SortMode sort_mode,
+                          std::vector<SortItem>& order) {
+  glm::vec3 eye = camera.get_position();
+  glm::vec3 front = camera.get_front();
+  uint32_t culled = 0;
+  order.clear();
+  for (size_t i = 0; i < sprites.size(); i++) {
+    const Sprite& s = sprites[i];
+    float depth = glm::dot(s.position - eye, front);
+    if (depth < NEAR_PLANE) {
+      culled++;
+      continue;
+    }
+    GLuint group = sort_mode == SortMode::TEXTURE ? s.texture : 0;
+    order.push_back(SortItem{group, depth_key(depth), (uint32_t)i});
+  }
+  std::sort(order.begin(), order.end(), [](const SortItem& a, const SortItem& b) {
+    if (a.group != b.group)
+      return a.group < b.group;
+    if (a.depth_key != b.depth_key)
+      return a.depth_key < b.depth_key;
+    return a.index < b.index;
+  });
+  return culled;
+}
+
+void SpriteBatch::write_vertices(const std::vector<Sprite>& sprites, const std::vector<SortItem>& order,
+                                 const Camera& camera, Vertex* out) {
+  // Upright billboards: they turn to face the camera but never tilt.
+  glm::vec3 right = camera.get_right();
+  glm::vec3 up = camera.get_world_up();
+  Vertex* v = out;
+  for (const SortItem& item : order) {
+    const Sprite& s = sprites[item.index];
+    glm::vec3 half_width = right * (s.size.x * 0.5f);
+    glm::vec3 height = up * s.size.y;
+    v[0] = Vertex{s.position - half_width + height, glm::vec2(s.uv_rect.x, s.uv_rect.y), s.color};
+    v[1] = Vertex{s.position + half_width + height, glm::vec2(s.uv_rect.z, s.uv_rect.y), s.color};
+    v[2] = Vertex{s.position + half_width, glm::vec2(s.uv_rect.z, s.uv_rect.w), s.color};
+    v[3] = Vertex{s.position - half_width, glm::vec2(s.uv_rect.x, s.uv_rect.w), s.color};
+    v += 4;
+  }
+}
+
+SpriteBatch::Stats SpriteBatch::get_stats() const {
+  return stats;
+}
+
+size_t SpriteBatch::size() const {
+  return sprites.size();
+}
+
+const StreamBuffer& SpriteBatch::get_vertex_stream() const {
+  return vertex_stream;
+}
@@ -0,0 +1,101 @@
+#pragma once
+#include "camera.h"
+#include "shader_program.h"
+#include "stream_buffer.h"
+#include "glm/mat4x4.hpp"
+#include "glm/vec2.hpp"
+#include "glm/vec3.hpp"
+#include "glm/vec4.hpp"
+
+#include <glad/glad.h>
+#include <cstdint>
+#include <vector>
+
+// Collects upright billboards (karts, items, scenery) during a frame and
+// draws them with as few draw calls as possible. All sprites share one
+// streaming vertex buffer; consecutive sprites on the same atlas page after
+// sorting become a single glDrawElements. Vertices are written straight
+// into a StreamBuffer segment, one segment per draw().
+class SpriteBatch {
+  public:
+    struct Sprite {
+      // Bottom centre of the billboard in world space.
+      glm::vec3 position;
+      glm::vec2 size;
+      // u0, v0, u1, v1 on the atlas page.
+      glm::vec4 uv_rect = glm::vec4(0.f, 0.f, 1.f, 1.f);
+      // RGBA8, red in the lowest byte; multiplied with the texel.
+      uint32_t color = 0xffffffff;
+      // Atlas page; 0 draws with a plain white texture.
+      GLuint texture = 0;
+    };
+
+    enum class SortMode {
+      // Far to near, for correct alpha blending. Pages only merge where
+      // neighbours in depth order share one.
+      BACK_TO_FRONT,
+      // Grouped by page, far to near within each page. One draw per page;
+      // only correct for opaque or alpha-tested sprites.
+      TEXTURE
+    };
+
+    struct Stats {
+      uint32_t sprites = 0;
+      uint32_t culled = 0;
+      uint32_t draw_calls = 0;
+    };
+
+    struct Vertex {
+      glm::vec3 pos;
+      glm::vec2 texcoord;
+      uint32_t color;
+    };
+
+    struct SortItem {
+      GLuint group;
+      // Bit pattern of the view depth, inverted so larger depths sort first.
+      uint32_t depth_key;
+      uint32_t index;
+    };
+
+  private:
+    ShaderProgram program;
+    ShaderProgram::Uniform<glm::mat4> view_projection;
+    ShaderProgram::Uniform<GLint> tex;
+    GLuint vao;
+    StreamBuffer vertex_stream;
+    GLuint ebo;
+    GLuint white_texture;
+    size_t index_capacity;
+    std::vector<Sprite> sprites;
+    std::vector<SortItem> order;
+    Stats stats;
+
+    void reserve_indices(size_t num_sprites);
+    void setup_vertex_attributes();
+
+  public:
+    explicit SpriteBatch(size_t initial_capacity = 1024);
+    ~SpriteBatch();
+    SpriteBatch(const SpriteBatch&) = delete;
+    SpriteBatch& operator=(const SpriteBatch&) = delete;
+
+    void clear();
+    void add(const Sprite& sprite);
+    // Builds the billboards facing camera, sorts them and draws them.
+    void draw(const Camera& camera, const glm::mat4& view_projection_matrix,
+              SortMode sort_mode = SortMode::BACK_TO_FRONT);
+    // Counts from the last draw().
+    Stats get_stats() const;
+
+    // The CPU half of draw(), which needs no GL context: fills order with
+    // the sprites in front of camera in drawing order and returns how many
+    // were culled.
+    static uint32_t sort(const std::vector<Sprite>& sprites, const Camera& camera, SortMode sort_mode,
+                         std::vector<SortItem>& order);
+    // Writes four vertices per entry of order, upright and facing camera.
+    static void write_vertices(const std::vector<Sprite>& sprites, const std::vector<SortItem>& order,
+                               const Camera& camera, Vertex* out);
+    size_t size() const;
+    const StreamBuffer& get_vertex_stream() const;
+};
@@ -0,0 +1,201 @@
+#include "stream_buffer.h"
+#include "gl_state.h"
+
+#include <algorithm>
+#include <cstring>
+#include <iostream>
+
+namespace {
+  const GLbitfield PERSISTENT_FLAGS = GL_MAP_WRITE_BIT | GL_MAP_PERSISTENT_BIT | GL_MAP_COHERENT_BIT;
+  const GLuint64 WAIT_TIMEOUT_NS = 1000000000;
+
+  size_t align_up(size_t offset, size_t alignment) {
+    if (alignment <= 1)
+      return offset;
+    return (offset + alignment - 1) / alignment * alignment;
+  }
+}
+
+StreamBuffer::StreamBuffer(GLenum target, size_t segment_size, int num_segments, Mode mode) :
+                           target{target},
+                           buffer{0},
+                           mode{mode},
+                           segment_size{segment_size},
+                           num_segments{num_segments},
+                           segment{0},
+                           cursor{0},
+                           orphaned{false},
+                           mapped_offset{0},
+                           mapped_size{0},
+                           persistent_ptr{nullptr},
+                           fences(num_segments, nullptr),
+                           stats{} {
+  create_storage();
+}
+
+StreamBuffer::~StreamBuffer() {
+  destroy_storage();
+}
+
+StreamBuffer::Mode StreamBuffer::best_mode() {
+  if (GLAD_GL_VERSION_4_4)
+    return Mode::PERSISTENT;
+  return Mode::UNSYNCHRONIZED;
+}
+
+const char* StreamBuffer::mode_name(Mode mode) {
+  switch (mode) {
+    case Mode::PERSISTENT:
+      return "persistent";
+    case Mode::UNSYNCHRONIZED:
+      return "unsynchronized";
+    default:
+      return "orphan";
+  }
+}
+
+void StreamBuffer::create_storage() {
+  size_t total = segment_size * num_segments;
+  glGenBuffers(1, &buffer);
+  GLState::bind_buffer(target, buffer);
+  if (mode == Mode::PERSISTENT) {
+    glBufferStorage(target, total, nullptr, PERSISTENT_FLAGS);
+    persistent_ptr = (unsigned char*)glMapBufferRange(target, 0, total, PERSISTENT_FLAGS);
+    if (persistent_ptr)
+      return;
+    std::cout << "Persistent mapping failed, falling back to unsynchronized maps.\n";
+    GLState::delete_buffer(buffer);
+    mode = Mode::UNSYNCHRONIZED;
+    glGenBuffers(1, &buffer);
+    GLState::bind_buffer(target, buffer);
+  }
+  glBufferData(target, total, nullptr, GL_STREAM_DRAW);
+}
+
+void StreamBuffer::destroy_storage() {
+  for (int i = 0; i < num_segments; i++)
+    wait_for_segment(i);
+  if (persistent_ptr) {
+    GLState::bind_buffer(target, buffer);
+    glUnmapBuffer(target);
+    persistent_ptr = nullptr;
+  }
+  GLState::delete_buffer(buffer);
+  buffer = 0;
+}
+
+void StreamBuffer::wait_for_segment(int index) {
+  GLsync fence = fences[index];
+  if (!fence)
+    return;
+  GLenum result = glClientWaitSync(fence, 0, 0);
+  if (result == GL_TIMEOUT_EXPIRED) {
+    stats.stalls++;
+    do {
+      result = glClientWaitSync(fence, GL_SYNC_FLUSH_COMMANDS_BIT, WAIT_TIMEOUT_NS);
+    } while (result == GL_TIMEOUT_EXPIRED);
+  }
+  glDeleteSync(fence);
+  fences[index] = nullptr;
+}
+
+bool StreamBuffer::reserve(size_t bytes) {
+  if (bytes <= segment_size)
+    return false;
+  segment_size = std::max(bytes, segment_size * 2);
+  segment = 0;
+  cursor = 0;
+  orphaned = false;
+  if (mode == Mode::PERSISTENT) {
+    // Buffer storage is immutable, so growing means a new buffer object.
+    destroy_storage();
+    create_storage();
+    return true;
+  }
+  // Respecifying the store orphans the old one; nothing in flight is touched.
+  for (auto& fence : fences) {
+    if (fence)
+      glDeleteSync(fence);
+    fence = nullptr;
+  }
+  GLState::bind_buffer(target, buffer);
+  glBufferData(target, segment_size * num_segments, nullptr, GL_STREAM_DRAW);
+  return false;
+}
+
+void* StreamBuffer::map(size_t bytes, size_t alignment, size_t& offset) {
+  size_t base = segment * segment_size;
+  size_t aligned = align_up(base + cursor, alignment);
+  if (aligned + bytes > base + segment_size)
+    return nullptr;
+  cursor = aligned + bytes - base;
+  offset = aligned;
+  mapped_offset = aligned;
+  mapped_size = bytes;
+  stats.bytes_written += bytes;
+
+  switch (mode) {
+    case Mode::PERSISTENT:
+      return persistent_ptr + aligned;
+    case Mode::UNSYNCHRONIZED:
+      GLState::bind_buffer(target, buffer);
+      return glMapBufferRange(target, aligned, bytes,
+          GL_MAP_WRITE_BIT | GL_MAP_UNSYNCHRONIZED_BIT | GL_MAP_INVALIDATE_RANGE_BIT);
+    default:
+      if (!orphaned) {
+        GLState::bind_buffer(target, buffer);
+        glBufferData(target, segment_size * num_segments, nullptr, GL_STREAM_DRAW);
+        orphaned = true;
+      }
+      staging.resize(bytes);
+      return staging.data();
+  }
+}
+
+void StreamBuffer::unmap() {
+  switch (mode) {
+    case Mode::PERSISTENT:
+      // Coherent mapping: writes are visible to the next draw.
+      return;
+    case Mode::UNSYNCHRONIZED:
+      GLState::bind_buffer(target, buffer);
+      glUnmapBuffer(target);
+      return;
+    default:
+      GLState::bind_buffer(target, buffer);
+      glBufferSubData(target, mapped_offset, mapped_size, staging.data());
+      return;
+  }
+}
+
+size_t StreamBuffer::write(const void* data, size_t bytes, size_t alignment) {
+  size_t offset;
+  void* dst = map(bytes, alignment, offset);
+  if (!dst)
+    return SIZE_MAX;
+  std::memcpy(dst, data, bytes);
+  unmap();
+  return offset;
+}
+
+void StreamBuffer::end_frame() {
+  cursor = 0;
+  orphaned = false;
+  if (mode == Mode::ORPHAN)
+    return;
+  fences[segment] = glFenceSync(GL_SYNC_GPU_COMMANDS_COMPLETE, 0);
+  segment = (segment + 1) % num_segments;
+  wait_for_segment(segment);
+}
+
+GLuint StreamBuffer::get_buffer() const {
+  return buffer;
+}
+
+StreamBuffer::Mode StreamBuffer::get_mode() const {
+  return mode;
+}
+
+StreamBuffer::Stats StreamBuffer::get_stats() const {
+  return stats;
+}
@@ -0,0 +1,81 @@
+#pragma once
+#include <glad/glad.h>
+#include <cstddef>
+#include <cstdint>
+#include <vector>
+
+// Ring of per-frame segments for data rewritten every frame (sprites,
+// particles, debug lines). The CPU writes into one segment while the GPU
+// may still read the previous ones; a fence per segment makes sure a
+// segment is only reused once the GPU is done with it.
+//
+// Offsets returned by map() are absolute, so draws either point attributes
+// at them or, for vertices, pass offset / stride as the base vertex.
+class StreamBuffer {
+  public:
+    enum class Mode {
+      // GL 4.4 buffer storage, mapped once for the buffer's lifetime.
+      PERSISTENT,
+      // glMapBufferRange with UNSYNCHRONIZED | INVALIDATE_RANGE per write.
+      UNSYNCHRONIZED,
+      // glBufferData(NULL) at the start of each frame, then glBufferSubData.
+      ORPHAN
+    };
+
+    struct Stats {
+      uint64_t bytes_written = 0;
+      // Frames where the next segment's fence had not signalled yet.
+      uint64_t stalls = 0;
+    };
+
+  private:
+    GLenum target;
+    GLuint buffer;
+    Mode mode;
+    size_t segment_size;
+    int num_segments;
+    int segment;
+    size_t cursor;
+    bool orphaned;
+    size_t mapped_offset;
+    size_t mapped_size;
+    unsigned char* persistent_ptr;
+    std::vector<GLsync> fences;
+    std::vector<unsigned char> staging;
+    Stats stats;
+
+    void create_storage();
+    void destroy_storage();
+    void wait_for_segment(int index);
+
+  public:
+    StreamBuffer(GLenum target, size_t segment_size, int num_segments = 3, Mode mode = best_mode());
+    ~StreamBuffer();
+    StreamBuffer(const StreamBuffer&) = delete;
+    StreamBuffer& operator=(const StreamBuffer&) = delete;
+
+    // PERSISTENT when the context supports buffer storage, else UNSYNCHRONIZED.
+    static Mode best_mode();
+    static const char* mode_name(Mode mode);
+
+    // Makes room for bytes per frame. Returns true if the buffer object
+    // was replaced, in which case attribute pointers must be set up again.
+    bool reserve(size_t bytes);
+
+    // Returns a pointer to write bytes into and the absolute offset they
+    // will live at, aligned to a multiple of alignment. Must be followed
+    // by unmap() before the data is drawn. Returns nullptr if the frame's
+    // segment is full; reserve() more up front.
+    void* map(size_t bytes, size_t alignment, size_t& offset);
+    void unmap();
+
+    // map() + memcpy + unmap(). Returns the offset, or SIZE_MAX if full.
+    size_t write(const void* data, size_t bytes, size_t alignment);
+
+    // Fences the current segment and moves to the next one.
+    void end_frame();
+
+    GLuint get_buffer() const;
+    Mode get_mode() const;
+    Stats get_stats() const;
+};
@@ -0,0 +1,117 @@
+#include "texture_atlas.h"
+#include "stb_image/stb_image.h"
+
+// imgui_draw.cpp compiles its own static copy, so this one must be static too.
+#define STBRP_STATIC
+#define STB_RECT_PACK_IMPLEMENTATION
+#include "imgui/imstb_rectpack.h"
+
+#include <algorithm>
+#include <iostream>
+
+const AtlasBuilder::Region* AtlasBuilder::Atlas::find(const std::string& name) const {
+  auto found = regions.find(name);
+  return found == regions.end() ? nullptr : &found->second;
+}
+
+namespace {
+  int round_up_to_power_of_two(int value) {
+    int power = 1;
+    while (power < value)
+      power *= 2;
+    return power;
+  }
+}
+
+AtlasBuilder::AtlasBuilder(int page_size, int padding) :
+                           page_size{page_size},
+                           padding{round_up_to_power_of_two(padding)} {
+}
+
+bool AtlasBuilder::add(const std::string& name, const uint32_t* texels, int width, int height) {
+  if (width <= 0 || height <= 0) {
+    std::cout << "Atlas: " << name << " is empty (" << width << "x" << height << ")\n";
+    return false;
+  }
+  images.push_back(Image{name, width, height, std::vector<uint32_t>(texels, texels + (size_t)width * height)});
+  return true;
+}
+
+bool AtlasBuilder::add_file(const std::string& filename) {
+  int width;
+  int height;
+  int num_color_channels;
+  unsigned char* data = stbi_load(filename.c_str(), &width, &height, &num_color_channels, 4);
+  if (!data) {
+    std::cout << "Failed to load image " << filename << ": " << stbi_failure_reason() << "\n";
+    return false;
+  }
+  bool added = add(filename, (const uint32_t*)data, width, height);
+  stbi_image_free(data);
+  return added;
+}
+
+AtlasBuilder::Atlas AtlasBuilder::build() const {
+  Atlas atlas{};
+  // Pack in units of whole cells so every rect lands on a cell boundary.
+  int cells = page_size / padding;
+  std::vector<stbrp_rect> pending;
+  for (size_t i = 0; i < images.size(); i++) {
+    stbrp_rect rect{};
+    rect.id = (int)i;
+    rect.w = (images[i].width + 2 * padding + padding - 1) / padding;
+    rect.h = (images[i].height + 2 * padding + padding - 1) / padding;
+    if (rect.w > cells || rect.h > cells) {
+      std::cout << "Atlas: " << images[i].name << " (" << images[i].width << "x" << images[i].height
+                << ") does not fit on a " << page_size << " page\n";
+      continue;
+    }
+    pending.push_back(rect);
+  }
+
+  // Mips stop where a cell is one texel; past that, levels would blend neighbours.
+  size_t max_levels = 1;
+  for (int cell = padding; cell > 1; cell /= 2)
+    max_levels++;
+
+  std::vector<stbrp_node> nodes(cells);
+  while (!pending.empty()) {
+    stbrp_context context;
+    stbrp_init_target(&context, cells, cells, nodes.data(), (int)nodes.size());
+    stbrp_pack_rects(&context, pending.data(), (int)pending.size());
+
+    uint32_t page = (uint32_t)atlas.pages.size();
+    std::vector<uint32_t> texels((size_t)page_size * page_size, 0);
+    std::vector<stbrp_rect> leftover;
+    for (const stbrp_rect& rect : pending) {
+      if (!rect.was_packed) {
+        leftover.push_back(rect);
+        continue;
+      }
+      const Image& image = images[rect.id];
+      int x0 = rect.x * padding + padding;
+      int y0 = rect.y * padding + padding;
+      // Copy the image and extrude its edges into the gutter.
+      for (int y = -padding; y < image.height + padding; y++) {
+        int src_y = std::clamp(y, 0, image.height - 1);
+        for (int x = -padding; x < image.width + padding; x++) {
+          int src_x = std::clamp(x, 0, image.width - 1);
+          texels[(size_t)(y0 + y) * page_size + x0 + x] = image.texels[(size_t)src_y * image.width + src_x];
+        }
+      }
+      Region region{};
+      region.page = page;
+      region.x = x0;
+      region.y = y0;
+      region.width = image.width;
+      region.height = image.height;
+      region.uv_rect = glm::vec4(x0, y0, x0 + image.width, y0 + image.height) / (float)page_size;
+      atlas.regions[image.name] = region;
+    }
+    // Every rect fits on an empty page, so each pass places at least one.
+    pending.swap(leftover);
+
+    atlas.pages.push_back(TextureData::from_mips(MipChain::build(texels.data(), page_size, page_size, max_levels)));
+  }
+  return atlas;
+}
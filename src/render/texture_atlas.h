@@ -0,0 +1,65 @@
+#pragma once
+#include "texture_data.h"
+#include "glm/vec4.hpp"
+
+#include <cstdint>
+#include <string>
+#include <unordered_map>
+#include <vector>
+
+// Packs many small images (sprites, icons, UI) onto a few large pages with
+// imstb_rectpack, so they can share a texture bind and batch together.
+//
+// Every image gets a gutter of padding texels filled by repeating its edge
+// texels, so bilinear filtering never picks up a neighbour. Images are also
+// placed on padding-aligned cells and pages only get mip levels down to a
+// cell of one texel, so box-filtered mips never mix neighbours either.
+// That needs padding to be a power of two, so other values are rounded up.
+class AtlasBuilder {
+  public:
+    struct Region {
+      uint32_t page;
+      // u0, v0, u1, v1 on the page, as SpriteBatch::Sprite::uv_rect expects.
+      glm::vec4 uv_rect;
+      // Texel rect of the image itself, without the gutter.
+      int x;
+      int y;
+      int width;
+      int height;
+    };
+
+    struct Atlas {
+      // Upload with Renderer::upload_texture, one texture per page.
+      std::vector<TextureData> pages;
+      std::unordered_map<std::string, Region> regions;
+
+      // nullptr if name was not packed.
+      const Region* find(const std::string& name) const;
+    };
+
+  private:
+    struct Image {
+      std::string name;
+      int width;
+      int height;
+      std::vector<uint32_t> texels;
+    };
+
+    int page_size;
+    int padding;
+    std::vector<Image> images;
+
+  public:
+    explicit AtlasBuilder(int page_size = 1024, int padding = 4);
+
+    // texels are RGBA8, red in the lowest byte, rows top to bottom. Prints
+    // the reason and returns false for an empty image, which has no edge to
+    // extrude into its gutter.
+    bool add(const std::string& name, const uint32_t* texels, int width, int height);
+    // Decodes filename and adds it under its filename. False if it failed to load.
+    bool add_file(const std::string& filename);
+
+    // Packs everything added so far. Images too large for a page are left
+    // out of regions with a message.
+    Atlas build() const;
+};
@@ -0,0 +1,58 @@
+#include "texture_data.h"
+#include "texture_file.h"
+#include "stb_image/stb_image.h"
+
+#include <iostream>
+
+const uint32_t* TextureData::level_data(size_t level) const {
+  return texels + levels[level].offset;
+}
+
+size_t TextureData::num_texels() const {
+  if (levels.empty())
+    return 0;
+  const MipChain::Level& last = levels.back();
+  return last.offset + (size_t)last.width * last.height;
+}
+
+bool TextureData::empty() const {
+  return levels.empty();
+}
+
+TextureData TextureData::from_mips(MipChain mips) {
+  TextureData tex{};
+  if (mips.levels.empty())
+    return tex;
+  auto storage = std::make_shared<MipChain>(std::move(mips));
+  tex.width = storage->levels[0].width;
+  tex.height = storage->levels[0].height;
+  tex.levels = storage->levels;
+  tex.texels = storage->texels.data();
+  tex.storage = storage;
+  return tex;
+}
+
+TextureData TextureData::load(const std::string& filename) {
+  TextureData tex{};
+  if (TextureFile::is_baked(filename)) {
+    auto mapped = std::make_shared<MappedTexture>();
+    if (!mapped->open(filename))
+      return tex;
+    tex.width = mapped->get_width();
+    tex.height = mapped->get_height();
+    tex.levels = mapped->get_levels();
+    tex.texels = mapped->texels();
+    tex.storage = mapped;
+    return tex;
+  }
+
+  int num_color_channels;
+  unsigned char* data = stbi_load(filename.c_str(), &tex.width, &tex.height, &num_color_channels, 4);
+  if (!data) {
+    std::cout << "Failed to load image " << filename << ": " << stbi_failure_reason() << "\n";
+    return TextureData{};
+  }
+  MipChain mips = MipChain::build((const uint32_t*)data, tex.width, tex.height);
+  stbi_image_free(data);
+  return from_mips(std::move(mips));
+}
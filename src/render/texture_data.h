@@ -0,0 +1,30 @@
+#pragma once
+#include "mip_chain.h"
+
+#include <cstddef>
+#include <cstdint>
+#include <memory>
+#include <string>
+#include <vector>
+
+// The mip levels of an RGBA8 texture in memory, however they got there.
+// Cheap to copy: the texels are shared, not duplicated.
+struct TextureData {
+  int width = 0;
+  int height = 0;
+  // Level 0 is the full image. Offsets are in texels from texels.
+  std::vector<MipChain::Level> levels;
+  const uint32_t* texels = nullptr;
+  // Owns texels: a MipChain decoded at load time or a mapped .ktex file.
+  std::shared_ptr<const void> storage;
+
+  const uint32_t* level_data(size_t level) const;
+  size_t num_texels() const;
+  bool empty() const;
+
+  // Takes ownership of mips.
+  static TextureData from_mips(MipChain mips);
+  // Maps .ktex files from texbake in place; decodes and mipmaps anything
+  // else. Safe to call from any thread. Returns empty data on failure.
+  static TextureData load(const std::string& filename);
+};
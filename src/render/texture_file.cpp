@@ -0,0 +1,164 @@
+#include "texture_file.h"
+
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+#include <cstdio>
+#include <iostream>
+
+static_assert(sizeof(TextureFile::Header) == 32, "Header layout is part of the file format");
+static_assert(sizeof(TextureFile::LevelEntry) == 16, "LevelEntry layout is part of the file format");
+
+namespace {
+  size_t align_up(size_t value, size_t alignment) {
+    return (value + alignment - 1) / alignment * alignment;
+  }
+}
+
+bool TextureFile::write(const MipChain& mips, const std::string& filename) {
+  if (mips.levels.empty())
+    return false;
+
+  std::vector<LevelEntry> entries;
+  size_t offset = align_up(sizeof(Header) + mips.num_levels() * sizeof(LevelEntry), ALIGNMENT);
+  for (const MipChain::Level& level : mips.levels) {
+    entries.push_back(LevelEntry{(uint32_t)level.width, (uint32_t)level.height, offset});
+    offset = align_up(offset + (size_t)level.width * level.height * sizeof(uint32_t), ALIGNMENT);
+  }
+
+  Header header{};
+  header.magic = MAGIC;
+  header.version = VERSION;
+  header.width = (uint32_t)mips.levels[0].width;
+  header.height = (uint32_t)mips.levels[0].height;
+  header.num_levels = (uint32_t)mips.num_levels();
+  header.file_size = offset;
+
+  FILE* file = std::fopen(filename.c_str(), "wb");
+  if (!file)
+    return false;
+  std::vector<unsigned char> contents(offset);
+  std::copy((const unsigned char*)&header, (const unsigned char*)(&header + 1), contents.begin());
+  std::copy((const unsigned char*)entries.data(), (const unsigned char*)(entries.data() + entries.size()),
+            contents.begin() + sizeof(Header));
+  for (size_t i = 0; i < mips.num_levels(); i++) {
+    const unsigned char* data = (const unsigned char*)mips.level_data(i);
+    size_t bytes = (size_t)mips.levels[i].width * mips.levels[i].height * sizeof(uint32_t);
+    std::copy(data, data + bytes, contents.begin() + entries[i].offset);
+  }
+  bool ok = std::fwrite(contents.data(), 1, contents.size(), file) == contents.size();
+  return std::fclose(file) == 0 && ok;
+}
+
+bool TextureFile::is_baked(const std::string& filename) {
+  const std::string extension = ".ktex";
+  return filename.size() >= extension.size() &&
+         filename.compare(filename.size() - extension.size(), extension.size(), extension) == 0;
+}
+
+MappedTexture::MappedTexture() :
+                             mapping{nullptr},
+                             mapping_size{0},
+                             base{nullptr},
+                             width{0},
+                             height{0} {
+}
+
+MappedTexture::~MappedTexture() {
+  close();
+}
+
+bool MappedTexture::open(const std::string& filename) {
+  close();
+  int fd = ::open(filename.c_str(), O_RDONLY);
+  if (fd < 0) {
+    std::cout << "Failed to open " << filename << "\n";
+    return false;
+  }
+  struct stat info;
+  if (fstat(fd, &info) != 0 || (size_t)info.st_size < sizeof(TextureFile::Header)) {
+    std::cout << "Texture file " << filename << " is too small\n";
+    ::close(fd);
+    return false;
+  }
+  mapping_size = (size_t)info.st_size;
+  mapping = mmap(nullptr, mapping_size, PROT_READ, MAP_PRIVATE, fd, 0);
+  // The mapping stays valid after the descriptor is closed.
+  ::close(fd);
+  if (mapping == MAP_FAILED) {
+    mapping = nullptr;
+    std::cout << "Failed to map " << filename << "\n";
+    return false;
+  }
+
+  const unsigned char* bytes = (const unsigned char*)mapping;
+  const TextureFile::Header* header = (const TextureFile::Header*)bytes;
+  size_t table_end = sizeof(TextureFile::Header) + (size_t)header->num_levels * sizeof(TextureFile::LevelEntry);
+  if (header->magic != TextureFile::MAGIC || header->version != TextureFile::VERSION ||
+      header->file_size != mapping_size || header->num_levels == 0 || table_end > mapping_size) {
+    std::cout << "Texture file " << filename << " is not a valid version " << TextureFile::VERSION
+              << " .ktex file\n";
+    close();
+    return false;
+  }
+
+  // Levels are addressed in texels from the first level, which starts on
+  // a 64-byte boundary, so every later offset divides evenly.
+  const TextureFile::LevelEntry* entries = (const TextureFile::LevelEntry*)(bytes + sizeof(TextureFile::Header));
+  base = (const uint32_t*)(bytes + entries[0].offset);
+  for (uint32_t i = 0; i < header->num_levels; i++) {
+    const TextureFile::LevelEntry& entry = entries[i];
+    size_t level_bytes = (size_t)entry.width * entry.height * sizeof(uint32_t);
+    if (entry.offset < entries[0].offset || entry.offset % TextureFile::ALIGNMENT != 0 ||
+        entry.offset + level_bytes > mapping_size) {
+      std::cout << "Texture file " << filename << " has a bad level " << i << "\n";
+      close();
+      return false;
+    }
+    levels.push_back(MipChain::Level{(int)entry.width, (int)entry.height,
+                                     (size_t)(entry.offset - entries[0].offset) / sizeof(uint32_t)});
+  }
+  width = (int)header->width;
+  height = (int)header->height;
+  // Tell the kernel the whole file is about to be read so it pages it in
+  // ahead of the upload instead of faulting one page at a time.
+  madvise(mapping, mapping_size, MADV_WILLNEED);
+  return true;
+}
+
+void MappedTexture::close() {
+  if (mapping)
+    munmap(mapping, mapping_size);
+  mapping = nullptr;
+  mapping_size = 0;
+  base = nullptr;
+  levels.clear();
+  width = 0;
+  height = 0;
+}
+
+int MappedTexture::get_width() const {
+  return width;
+}
+
+int MappedTexture::get_height() const {
+  return height;
+}
+
+const std::vector<MipChain::Level>& MappedTexture::get_levels() const {
+  return levels;
+}
+
+const uint32_t* MappedTexture::texels() const {
+  return base;
+}
+
+const uint32_t* MappedTexture::level_data(size_t level) const {
+  return base + levels[level].offset;
+}
+
+size_t MappedTexture::num_levels() const {
+  return levels.size();
+}
@@ -0,0 +1,71 @@
+#pragma once
+#include "mip_chain.h"
+
+#include <cstddef>
+#include <cstdint>
+#include <string>
+#include <vector>
+
+// Baked textures (.ktex), written offline by texbake so the game never
+// decodes a PNG at startup. The file is a Header, a LevelEntry per mip level
+// and then the texels of each level, RGBA8 with red in the lowest byte, each
+// level starting on a 64-byte boundary. That is the layout glTexImage2D
+// (GL_RGBA, GL_UNSIGNED_BYTE) and the software renderer both read directly,
+// so a mapped file is used in place. All fields are little-endian.
+namespace TextureFile {
+  constexpr uint32_t MAGIC = 0x5845544b; // "KTEX"
+  constexpr uint32_t VERSION = 1;
+  constexpr size_t ALIGNMENT = 64;
+
+  struct Header {
+    uint32_t magic;
+    uint32_t version;
+    uint32_t width;
+    uint32_t height;
+    uint32_t num_levels;
+    uint32_t reserved;
+    // Total file size, to catch truncated files.
+    uint64_t file_size;
+  };
+
+  struct LevelEntry {
+    uint32_t width;
+    uint32_t height;
+    // From the start of the file.
+    uint64_t offset;
+  };
+
+  bool write(const MipChain& mips, const std::string& filename);
+  // True if filename names a baked texture rather than a source image.
+  bool is_baked(const std::string& filename);
+}
+
+// A .ktex file mapped read-only. Level offsets are in texels from texels(),
+// like MipChain, so code written against one works with the other.
+class MappedTexture {
+  private:
+    void* mapping;
+    size_t mapping_size;
+    const uint32_t* base;
+    std::vector<MipChain::Level> levels;
+    int width;
+    int height;
+
+  public:
+    MappedTexture();
+    ~MappedTexture();
+    MappedTexture(const MappedTexture&) = delete;
+    MappedTexture& operator=(const MappedTexture&) = delete;
+
+    // Maps and validates filename. Prints the reason and returns false if
+    // the file is missing or malformed.
+    bool open(const std::string& filename);
+    void close();
+
+    int get_width() const;
+    int get_height() const;
+    const std::vector<MipChain::Level>& get_levels() const;
+    const uint32_t* texels() const;
+    const uint32_t* level_data(size_t level) const;
+    size_t num_levels() const;
+};
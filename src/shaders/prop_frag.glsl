@@ -0,0 +1,12 @@
+R"glsl(
+#version 150 core
+in vec2 texcoord_out;
+out vec4 out_color;
+uniform sampler2D tex;
+void main() {
+  vec4 color = texture(tex, texcoord_out);
+  if (color.a < 0.5)
+    discard;
+  out_color = color;
+}
+)glsl"
@@ -0,0 +1,14 @@
+R"glsl(
+#version 150 core
+in vec3 pos;
+in vec2 texcoord;
+in mat4 transform;
+in vec4 atlas_rect;
+out vec2 texcoord_out;
+uniform mat4 view_projection;
+
+void main() {
+  gl_Position = view_projection * transform * vec4(pos, 1.0);
+  texcoord_out = mix(atlas_rect.xy, atlas_rect.zw, texcoord);
+}
+)glsl"
@@ -0,0 +1,10 @@
+R"glsl(
+#version 150 core
+in vec2 texcoord_out;
+in vec4 color_out;
+out vec4 out_color;
+uniform sampler2D tex;
+void main() {
+  out_color = texture(tex, texcoord_out) * color_out;
+}
+)glsl"
@@ -0,0 +1,15 @@
+R"glsl(
+#version 150 core
+in vec3 pos;
+in vec2 texcoord;
+in vec4 color;
+out vec2 texcoord_out;
+out vec4 color_out;
+uniform mat4 view_projection;
+
+void main() {
+  gl_Position = view_projection * vec4(pos, 1.0);
+  texcoord_out = texcoord;
+  color_out = color;
+}
+)glsl"
@@ -0,0 +1,31 @@
+#pragma once
+#include <cstddef>
+#include <cstdint>
+#include <vector>
+
+// FNV-1a over the raw bytes of simulation state. Floats are hashed by bit
+// pattern, so two runs only match if they are bit-identical, which is what
+// replays and rollback need.
+namespace Checksum {
+  const uint64_t SEED = 0xcbf29ce484222325ull;
+  const uint64_t PRIME = 0x100000001b3ull;
+
+  inline uint64_t add(uint64_t hash, const void* data, size_t bytes) {
+    const unsigned char* p = (const unsigned char*)data;
+    for (size_t i = 0; i < bytes; i++) {
+      hash ^= p[i];
+      hash *= PRIME;
+    }
+    return hash;
+  }
+
+  template<typename T>
+  uint64_t add(uint64_t hash, const T& value) {
+    return add(hash, &value, sizeof(T));
+  }
+
+  template<typename T>
+  uint64_t add(uint64_t hash, const std::vector<T>& values) {
+    return add(hash, values.data(), values.size() * sizeof(T));
+  }
+}
@@ -0,0 +1,32 @@
+#pragma once
+#include <bitset>
+#include <cstdint>
+
+class Input {
+  private:
+    std::bitset<16> actions{};
+  public:
+    enum Action {
+      MOVE_FORWARD,
+      MOVE_BACKWARD,
+      TURN_LEFT,
+      TURN_RIGHT,
+      DRIFT
+    };
+    void set_action(Action a) {
+      actions.set(a);
+    }
+    void unset_action(Action a) {
+      actions.reset(a);
+    }
+    bool is_action_set(Action a) const {
+      return actions.test(a);
+    }
+    // Every action as one bit, for recording and replaying input.
+    uint16_t get_bits() const {
+      return (uint16_t)actions.to_ulong();
+    }
+    void set_bits(uint16_t bits) {
+      actions = std::bitset<16>{bits};
+    }
+};
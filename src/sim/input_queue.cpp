@@ -0,0 +1,38 @@
+#include "input_queue.h"
+
+#include <chrono>
+
+InputQueue::InputQueue() :
+                       held{},
+                       dropped{0} {
+}
+
+double InputQueue::now() {
+  return std::chrono::duration<double>(std::chrono::steady_clock::now().time_since_epoch()).count();
+}
+
+bool InputQueue::push(const Event& event) {
+  if (ring.push(event))
+    return true;
+  dropped.fetch_add(1, std::memory_order_relaxed);
+  return false;
+}
+
+Input InputQueue::input_at(double time) {
+  // Events are pushed in time order, so stop at the first one from a later
+  // tick and leave it for the next call.
+  while (const Event* event = ring.peek()) {
+    if (event->time > time)
+      break;
+    if (event->pressed)
+      held.set_action(event->action);
+    else
+      held.unset_action(event->action);
+    ring.pop();
+  }
+  return held;
+}
+
+uint64_t InputQueue::get_dropped() const {
+  return dropped.load(std::memory_order_relaxed);
+}
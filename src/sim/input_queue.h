@@ -0,0 +1,54 @@
+#pragma once
+#include "sim/input.h"
+#include "sim/spsc_ring.h"
+
+#include <atomic>
+#include <cstdint>
+
+// Key presses and releases on their way from the window thread to the
+// simulation. Each event carries a time, and the simulation applies it to
+// the tick that time falls in, so events that arrive together still land
+// on the ticks they are stamped with. GLFW only reports keys from
+// glfwPollEvents(), though, so the time is when the window thread polled,
+// not when the key went down: a press takes effect on the first tick
+// ending after the poll that saw it.
+//
+// One thread pushes, one thread reads; neither ever blocks.
+class InputQueue {
+  public:
+    struct Event {
+      // Seconds, from now(). For keys, when the event was polled.
+      double time;
+      Input::Action action;
+      bool pressed;
+    };
+
+    static constexpr size_t CAPACITY = 256;
+
+  private:
+    SpscRing<Event, CAPACITY> ring;
+    // Consumer side: keys held as of the last event applied.
+    Input held;
+    std::atomic<uint64_t> dropped;
+
+  public:
+    InputQueue();
+    InputQueue(const InputQueue&) = delete;
+    InputQueue& operator=(const InputQueue&) = delete;
+
+    // Seconds on the steady clock. Events and simulation ticks are both
+    // timed with this, so the two line up.
+    static double now();
+
+    // Producer. Returns false if the consumer has fallen CAPACITY events
+    // behind, in which case the event is lost.
+    bool push(const Event& event);
+
+    // Consumer. Applies every event stamped at or before time and returns
+    // the keys held then, i.e. the input for the tick ending at time. Times
+    // must not go backwards between calls.
+    Input input_at(double time);
+
+    // Events lost to a full ring since startup.
+    uint64_t get_dropped() const;
+};
@@ -0,0 +1,126 @@
+#include "input_recording.h"
+
+#include <cstdio>
+#include <iostream>
+#include <limits>
+
+static_assert(sizeof(InputRecording::Header) == 32, "Header layout is part of the file format");
+static_assert(sizeof(InputRecording::Run) == 8, "Run layout is part of the file format");
+
+InputRecording::Playback::Playback(const InputRecording& recording) :
+                                   runs{&recording.runs},
+                                   run{0},
+                                   tick_in_run{0} {
+}
+
+bool InputRecording::Playback::done() const {
+  return run >= runs->size();
+}
+
+Input InputRecording::Playback::next() {
+  const Run& current = (*runs)[run];
+  Input input{};
+  input.set_bits(current.actions);
+  if (++tick_in_run == current.ticks) {
+    run++;
+    tick_in_run = 0;
+  }
+  return input;
+}
+
+InputRecording::InputRecording() :
+                               num_ticks{0},
+                               final_checksum{0} {
+}
+
+void InputRecording::record(const Input& input) {
+  uint16_t actions = input.get_bits();
+  if (!runs.empty() && runs.back().actions == actions &&
+      runs.back().ticks < std::numeric_limits<uint32_t>::max())
+    runs.back().ticks++;
+  else
+    runs.push_back(Run{actions, 0, 1});
+  num_ticks++;
+}
+
+void InputRecording::clear() {
+  runs.clear();
+  num_ticks = 0;
+  final_checksum = 0;
+}
+
+void InputRecording::set_final_checksum(uint64_t checksum) {
+  final_checksum = checksum;
+}
+
+bool InputRecording::save(const std::string& filename) const {
+  Header header{};
+  header.magic = MAGIC;
+  header.version = VERSION;
+  header.num_runs = (uint32_t)runs.size();
+  header.num_ticks = num_ticks;
+  header.final_checksum = final_checksum;
+
+  FILE* file = std::fopen(filename.c_str(), "wb");
+  if (!file)
+    return false;
+  bool ok = std::fwrite(&header, sizeof(header), 1, file) == 1 &&
+            std::fwrite(runs.data(), sizeof(Run), runs.size(), file) == runs.size();
+  return std::fclose(file) == 0 && ok;
+}
+
+bool InputRecording::load(const std::string& filename) {
+  clear();
+  FILE* file = std::fopen(filename.c_str(), "rb");
+  if (!file) {
+    std::cout << "Failed to open " << filename << "\n";
+    return false;
+  }
+  Header header{};
+  bool ok = std::fread(&header, sizeof(header), 1, file) == 1;
+  if (ok && (header.magic != MAGIC || header.version != VERSION)) {
+    std::cout << filename << " is not a version " << VERSION << " input recording\n";
+    std::fclose(file);
+    return false;
+  }
+  if (ok) {
+    // Check the run count against what the file holds before allocating
+    // for it, so a corrupt count fails here instead of in resize().
+    long runs_start = std::ftell(file);
+    ok = runs_start >= 0 && std::fseek(file, 0, SEEK_END) == 0;
+    long file_end = ok ? std::ftell(file) : -1;
+    ok = ok && file_end >= runs_start && std::fseek(file, runs_start, SEEK_SET) == 0 &&
+         (uint64_t)header.num_runs * sizeof(Run) <= (uint64_t)(file_end - runs_start);
+  }
+  if (ok) {
+    runs.resize(header.num_runs);
+    ok = std::fread(runs.data(), sizeof(Run), runs.size(), file) == runs.size();
+  }
+  std::fclose(file);
+
+  uint64_t ticks = 0;
+  for (const Run& run : runs) {
+    ok = ok && run.ticks > 0;
+    ticks += run.ticks;
+  }
+  if (!ok || ticks != header.num_ticks) {
+    std::cout << filename << " is truncated or corrupt\n";
+    clear();
+    return false;
+  }
+  num_ticks = header.num_ticks;
+  final_checksum = header.final_checksum;
+  return true;
+}
+
+const std::vector<InputRecording::Run>& InputRecording::get_runs() const {
+  return runs;
+}
+
+uint64_t InputRecording::get_num_ticks() const {
+  return num_ticks;
+}
+
+uint64_t InputRecording::get_final_checksum() const {
+  return final_checksum;
+}
@@ -0,0 +1,72 @@
+#pragma once
+#include "sim/input.h"
+
+#include <cstddef>
+#include <cstdint>
+#include <string>
+#include <vector>
+
+// The Input of every tick of a session, run-length encoded: players hold
+// the same keys for many ticks, so a run of identical ticks costs 8 bytes
+// however long it lasts. Because the simulation is deterministic, feeding
+// the recording back reproduces the session exactly; the checksum of the
+// final state is stored alongside so a replay can prove it.
+//
+// Files (.krep) are a Header followed by the runs. All fields are
+// little-endian.
+class InputRecording {
+  public:
+    static constexpr uint32_t MAGIC = 0x5045524b; // "KREP"
+    static constexpr uint32_t VERSION = 1;
+
+    struct Header {
+      uint32_t magic;
+      uint32_t version;
+      uint32_t num_runs;
+      uint32_t reserved;
+      uint64_t num_ticks;
+      // Simulation::checksum() after the last tick, 0 if not recorded.
+      uint64_t final_checksum;
+    };
+
+    struct Run {
+      uint16_t actions;
+      uint16_t reserved;
+      uint32_t ticks;
+    };
+
+    // Reads a recording back one tick at a time.
+    class Playback {
+      private:
+        const std::vector<Run>* runs;
+        size_t run;
+        uint32_t tick_in_run;
+
+      public:
+        explicit Playback(const InputRecording& recording);
+        bool done() const;
+        // The next tick's input. Must not be called once done().
+        Input next();
+    };
+
+  private:
+    std::vector<Run> runs;
+    uint64_t num_ticks;
+    uint64_t final_checksum;
+
+  public:
+    InputRecording();
+
+    // Appends one tick.
+    void record(const Input& input);
+    void clear();
+    void set_final_checksum(uint64_t checksum);
+
+    bool save(const std::string& filename) const;
+    // Prints the reason and returns false if the file is missing or malformed.
+    bool load(const std::string& filename);
+
+    const std::vector<Run>& get_runs() const;
+    uint64_t get_num_ticks() const;
+    uint64_t get_final_checksum() const;
+};
@@ -0,0 +1,215 @@
+#include "kart_physics.h"
+#include "sim/checksum.h"
+#include "jobs/job_system.h"
+
+#include <algorithm>
+#include <cmath>
+
+namespace {
+  // Free function so the restrict qualifiers are on parameters, which is
+  // where GCC honours them when deciding the arrays can't overlap.
+  void integrate(size_t n, float dt, const KartPhysics::Params& params,
+                 const float* __restrict throttle, const float* __restrict steer,
+                 const uint8_t* __restrict drift, const float* __restrict surface_drag,
+                 const float* __restrict surface_max_forward, const float* __restrict surface_boost,
+                 const float* __restrict x, const float* __restrict z,
+                 float* __restrict vx, float* __restrict vz,
+                 float* __restrict dir_x, float* __restrict dir_z,
+                 float* __restrict nx, float* __restrict nz) {
+    // Parameters as locals, and drift as a 0/1 blend rather than a branch, so
+    // the loop body is straight-line arithmetic.
+    const float reverse_ratio = params.max_reverse_speed / params.max_speed;
+    const float acceleration = params.acceleration;
+    const float brake = params.brake;
+    const float turn_step = params.turn_rate * dt;
+    const float inv_turn_speed = 1.0f / params.turn_speed;
+    const float drift_turn_extra = params.drift_turn_scale - 1.0f;
+    const float grip_loss = std::min(params.grip * dt, 1.0f);
+    const float drift_grip_loss = std::min(params.drift_grip * dt, 1.0f);
+    for (size_t i = 0; i < n; i++) {
+      float dx = dir_x[i];
+      float dz = dir_z[i];
+      float drifting = (float)drift[i];
+      // Velocity in the kart's frame; right is the heading turned 90 degrees.
+      float forward = vx[i] * dx + vz[i] * dz;
+      float lateral = vx[i] * -dz + vz[i] * dx;
+
+      float accel = std::max(throttle[i], 0.0f) * acceleration + std::min(throttle[i], 0.0f) * brake;
+      forward += (accel + surface_boost[i]) * dt;
+      forward -= forward * std::min(surface_drag[i] * dt, 1.0f);
+      forward = std::min(std::max(forward, -surface_max_forward[i] * reverse_ratio), surface_max_forward[i]);
+
+      // Steering follows the direction of travel, so reversing turns the
+      // other way, and fades out near standstill.
+      float speed_factor = std::min(std::max(forward * inv_turn_speed, -1.0f), 1.0f);
+      float angle = steer[i] * turn_step * speed_factor * (1.0f + drifting * drift_turn_extra);
+      // Taylor series; a tick's turn is well under 0.1 rad, where these are
+      // exact to float precision.
+      float a2 = angle * angle;
+      float c = 1.0f - a2 * (0.5f - a2 * (1.0f / 24.0f));
+      float s = angle * (1.0f - a2 * ((1.0f / 6.0f) - a2 * (1.0f / 120.0f)));
+      float ndx = dx * c - dz * s;
+      float ndz = dx * s + dz * c;
+      // One Newton step back to unit length stops rounding drift piling up.
+      float k = 1.5f - 0.5f * (ndx * ndx + ndz * ndz);
+      ndx *= k;
+      ndz *= k;
+
+      lateral -= lateral * (grip_loss + drifting * (drift_grip_loss - grip_loss));
+
+      dir_x[i] = ndx;
+      dir_z[i] = ndz;
+      vx[i] = ndx * forward - ndz * lateral;
+      vz[i] = ndz * forward + ndx * lateral;
+      nx[i] = x[i] + vx[i] * dt;
+      nz[i] = z[i] + vz[i] * dt;
+    }
+  }
+  // Moves are blended with 0/1 weights instead of selected, which keeps the
+  // loop free of control flow; n * 1 + x * 0 is exactly n.
+  void resolve_walls(size_t n, float restitution, const Surface* __restrict hit,
+                     const Surface* __restrict hit_x, const Surface* __restrict hit_z,
+                     const float* __restrict nx, const float* __restrict nz,
+                     float* __restrict x, float* __restrict z,
+                     float* __restrict vx, float* __restrict vz) {
+    for (size_t i = 0; i < n; i++) {
+      int blocked = hit[i] == Surface::WALL;
+      int blocked_x = hit_x[i] == Surface::WALL;
+      int blocked_z = hit_z[i] == Surface::WALL;
+      float move_x = (float)(1 - (blocked & blocked_x));
+      float move_z = (float)(1 - (blocked & (1 - (blocked_x & (1 - blocked_z)))));
+      x[i] = nx[i] * move_x + x[i] * (1.0f - move_x);
+      z[i] = nz[i] * move_z + z[i] * (1.0f - move_z);
+      vx[i] *= move_x - (1.0f - move_x) * restitution;
+      vz[i] *= move_z - (1.0f - move_z) * restitution;
+    }
+  }
+}
+
+KartPhysics::KartPhysics() :
+                         KartPhysics{Params{}} {
+}
+
+KartPhysics::KartPhysics(const Params& params) :
+                         params{params} {
+}
+
+size_t KartPhysics::add_kart(float x, float z, float heading_x, float heading_z) {
+  float length = std::sqrt(heading_x * heading_x + heading_z * heading_z);
+  if (length == 0.0f) {
+    heading_x = 0.0f;
+    heading_z = 1.0f;
+    length = 1.0f;
+  }
+  karts.x.push_back(x);
+  karts.z.push_back(z);
+  karts.vx.push_back(0.0f);
+  karts.vz.push_back(0.0f);
+  karts.dir_x.push_back(heading_x / length);
+  karts.dir_z.push_back(heading_z / length);
+  karts.throttle.push_back(0.0f);
+  karts.steer.push_back(0.0f);
+  karts.drift.push_back(0);
+  karts.surface.push_back(Surface::ROAD);
+  return karts.x.size() - 1;
+}
+
+void KartPhysics::set_controls(size_t kart, float throttle, float steer, bool drift) {
+  karts.throttle[kart] = std::clamp(throttle, -1.0f, 1.0f);
+  karts.steer[kart] = std::clamp(steer, -1.0f, 1.0f);
+  karts.drift[kart] = drift;
+}
+
+void KartPhysics::clear() {
+  karts = Karts{};
+}
+
+size_t KartPhysics::size() const {
+  return karts.x.size();
+}
+
+void KartPhysics::step(float dt, const TrackMap* track, JobSystem* jobs) {
+  const size_t n = size();
+  drag.resize(n);
+  max_forward.resize(n);
+  boost.resize(n);
+  next_x.resize(n);
+  next_z.resize(n);
+  hit.resize(n);
+  hit_x.resize(n);
+  hit_z.resize(n);
+
+  // Karts don't interact, so any split gives the same result as one pass.
+  if (jobs && n >= PARALLEL_CHUNK * 2)
+    jobs->parallel_for(n, PARALLEL_CHUNK, [&](size_t begin, size_t end) { step_range(dt, track, begin, end); });
+  else
+    step_range(dt, track, 0, n);
+}
+
+void KartPhysics::step_range(float dt, const TrackMap* track, size_t begin, size_t end) {
+  const size_t n = end - begin;
+  float* x = karts.x.data() + begin;
+  float* z = karts.z.data() + begin;
+  Surface* surface = karts.surface.data() + begin;
+
+  // Surfaces under each kart, then their parameters gathered into flat
+  // arrays so the integration loop below does no table lookups.
+  if (track)
+    track->surfaces_at(x, z, n, surface);
+  else
+    std::fill(surface, surface + n, Surface::ROAD);
+  for (size_t i = begin; i < end; i++) {
+    const SurfaceParams& surface_params = params.surfaces[(size_t)karts.surface[i]];
+    drag[i] = surface_params.drag;
+    max_forward[i] = params.max_speed * surface_params.speed_scale;
+    boost[i] = surface_params.boost;
+  }
+
+  integrate(n, dt, params, karts.throttle.data() + begin, karts.steer.data() + begin,
+            karts.drift.data() + begin, drag.data() + begin, max_forward.data() + begin,
+            boost.data() + begin, x, z, karts.vx.data() + begin, karts.vz.data() + begin,
+            karts.dir_x.data() + begin, karts.dir_z.data() + begin,
+            next_x.data() + begin, next_z.data() + begin);
+
+  if (!track) {
+    std::copy(next_x.begin() + begin, next_x.begin() + end, karts.x.begin() + begin);
+    std::copy(next_z.begin() + begin, next_z.begin() + end, karts.z.begin() + begin);
+    return;
+  }
+
+  // Walls: try the full move, then each axis alone, so a kart hitting a
+  // wall at an angle slides along it and bounces off only the blocked axis.
+  const float* nx = next_x.data() + begin;
+  const float* nz = next_z.data() + begin;
+  track->surfaces_at(nx, nz, n, hit.data() + begin);
+  track->surfaces_at(nx, z, n, hit_x.data() + begin);
+  track->surfaces_at(x, nz, n, hit_z.data() + begin);
+  resolve_walls(n, params.wall_restitution, hit.data() + begin, hit_x.data() + begin,
+                hit_z.data() + begin, nx, nz, x, z, karts.vx.data() + begin, karts.vz.data() + begin);
+}
+
+uint64_t KartPhysics::checksum(uint64_t hash) const {
+  hash = Checksum::add(hash, karts.x);
+  hash = Checksum::add(hash, karts.z);
+  hash = Checksum::add(hash, karts.vx);
+  hash = Checksum::add(hash, karts.vz);
+  hash = Checksum::add(hash, karts.dir_x);
+  hash = Checksum::add(hash, karts.dir_z);
+  hash = Checksum::add(hash, karts.throttle);
+  hash = Checksum::add(hash, karts.steer);
+  hash = Checksum::add(hash, karts.drift);
+  hash = Checksum::add(hash, karts.surface);
+  return hash;
+}
+
+const KartPhysics::Karts& KartPhysics::get_karts() const {
+  return karts;
+}
+
+KartPhysics::Karts& KartPhysics::get_karts() {
+  return karts;
+}
+
+const KartPhysics::Params& KartPhysics::get_params() const {
+  return params;
+}
@@ -0,0 +1,114 @@
+#pragma once
+#include "sim/track_map.h"
+
+#include <array>
+#include <cstddef>
+#include <cstdint>
+#include <vector>
+
+class JobSystem;
+
+// Arcade kart dynamics for every kart in a race, stored as structure of
+// arrays so one tick is a handful of straight loops over contiguous floats
+// that the compiler can vectorize. Karts move in the xz plane; headings are
+// unit vectors rather than angles, so steering is a small rotation and the
+// loop never calls sin or cos.
+class KartPhysics {
+  public:
+    struct SurfaceParams {
+      // Fraction of forward speed lost per second.
+      float drag;
+      // Multiplies max_speed.
+      float speed_scale;
+      // Extra forward acceleration, for boost pads.
+      float boost;
+    };
+
+    struct Params {
+      // Units per second squared; the course is one unit across.
+      float acceleration = 0.35f;
+      float brake = 0.6f;
+      float max_speed = 0.3f;
+      float max_reverse_speed = 0.08f;
+      // Radians per second at full lock.
+      float turn_rate = 2.0f;
+      // Below this speed turning fades out, so karts can't spin in place.
+      float turn_speed = 0.06f;
+      // Fraction of sideways speed removed per second. Drifting trades grip
+      // for a tighter turn.
+      float grip = 14.0f;
+      float drift_grip = 2.5f;
+      float drift_turn_scale = 1.5f;
+      // Fraction of speed kept when bouncing off a wall.
+      float wall_restitution = 0.3f;
+      std::array<SurfaceParams, (size_t)Surface::COUNT> surfaces = {{
+        {0.1f, 1.0f, 0.0f},  // ROAD
+        {1.0f, 0.6f, 0.0f},  // GRASS
+        {2.0f, 0.4f, 0.0f},  // OFF_TRACK
+        {0.1f, 1.0f, 0.0f},  // WALL, only reached by spawning inside one
+        {0.0f, 1.5f, 0.8f}   // BOOST
+      }};
+    };
+
+    // One entry per kart in every array. Controls are written by players and
+    // AI before step(); the rest is state owned by step().
+    struct Karts {
+      std::vector<float> x;
+      std::vector<float> z;
+      std::vector<float> vx;
+      std::vector<float> vz;
+      // Unit heading.
+      std::vector<float> dir_x;
+      std::vector<float> dir_z;
+      // -1 full brake / reverse to 1 full throttle.
+      std::vector<float> throttle;
+      // -1 full left to 1 full right.
+      std::vector<float> steer;
+      std::vector<uint8_t> drift;
+      // What each kart was on at the start of the last step().
+      std::vector<Surface> surface;
+    };
+
+  private:
+    Params params;
+    Karts karts;
+    // Per-tick scratch, kept to avoid allocating every tick.
+    std::vector<float> drag;
+    std::vector<float> max_forward;
+    std::vector<float> boost;
+    std::vector<float> next_x;
+    std::vector<float> next_z;
+    std::vector<Surface> hit;
+    std::vector<Surface> hit_x;
+    std::vector<Surface> hit_z;
+
+    void step_range(float dt, const TrackMap* track, size_t begin, size_t end);
+
+  public:
+    // Karts per job when stepping in parallel; enough that a chunk's
+    // arrays fill many cache lines and job overhead stays negligible.
+    static constexpr size_t PARALLEL_CHUNK = 2048;
+
+    KartPhysics();
+    explicit KartPhysics(const Params& params);
+
+    // Returns the new kart's index. heading need not be normalized.
+    size_t add_kart(float x, float z, float heading_x, float heading_z);
+    void set_controls(size_t kart, float throttle, float steer, bool drift);
+    void clear();
+    size_t size() const;
+
+    // Advances every kart by dt seconds. With no track, everywhere is road.
+    // Large fields are split across jobs, if given; the result is identical
+    // either way.
+    void step(float dt, const TrackMap* track, JobSystem* jobs = nullptr);
+
+    // Hash of every kart's state and controls, for checking that two runs
+    // fed the same input stay bit-identical.
+    uint64_t checksum(uint64_t hash) const;
+
+    const Karts& get_karts() const;
+    // For writing controls for many karts at once.
+    Karts& get_karts();
+    const Params& get_params() const;
+};
@@ -0,0 +1,87 @@
+#include "simulation.h"
+#include "sim/checksum.h"
+#include "profiler/profiler.h"
+
+namespace {
+  // On the grid behind the start line of course.png, facing up the straight.
+  const float START_X = -0.5f + 96.5f / 1024.f;
+  const float START_Z = 0.2f - 470.5f / 1024.f;
+  const float CHASE_DISTANCE = 0.04f;
+}
+
+Simulation::Simulation() :
+                       track{nullptr},
+                       jobs{nullptr},
+                       view{},
+                       prev_view{},
+                       tick{0} {
+  karts.add_kart(START_X, START_Z, 0.f, 1.f);
+  update_view();
+  prev_view = view;
+  prev_x = karts.get_karts().x;
+  prev_z = karts.get_karts().z;
+}
+
+void Simulation::set_track(const TrackMap* track) {
+  this->track = track;
+}
+
+void Simulation::set_job_system(JobSystem* jobs) {
+  this->jobs = jobs;
+}
+
+void Simulation::update_view() {
+  const KartPhysics::Karts& k = karts.get_karts();
+  float dir_x = k.dir_x[PLAYER_KART];
+  float dir_z = k.dir_z[PLAYER_KART];
+  view.position = glm::vec3{k.x[PLAYER_KART] - dir_x * CHASE_DISTANCE, 0.f, k.z[PLAYER_KART] - dir_z * CHASE_DISTANCE};
+  view.front = glm::vec3{dir_x, 0.f, dir_z};
+}
+
+void Simulation::step(const Input& input) {
+  Profiler::Scope zone{"sim"};
+  prev_view = view;
+  prev_x = karts.get_karts().x;
+  prev_z = karts.get_karts().z;
+  float throttle = (float)input.is_action_set(Input::Action::MOVE_FORWARD) -
+                   (float)input.is_action_set(Input::Action::MOVE_BACKWARD);
+  float steer = (float)input.is_action_set(Input::Action::TURN_RIGHT) -
+                (float)input.is_action_set(Input::Action::TURN_LEFT);
+  karts.set_controls(PLAYER_KART, throttle, steer, input.is_action_set(Input::Action::DRIFT));
+  karts.step(TICK_SECONDS, track, jobs);
+  update_view();
+  tick++;
+}
+
+void Simulation::write_snapshot(Snapshot& out, double time) const {
+  const KartPhysics::Karts& k = karts.get_karts();
+  out.tick = tick;
+  out.time = time;
+  out.prev_view = prev_view;
+  out.view = view;
+  out.prev_x = prev_x;
+  out.prev_z = prev_z;
+  out.x = k.x;
+  out.z = k.z;
+  out.dir_x = k.dir_x;
+  out.dir_z = k.dir_z;
+}
+
+Camera Simulation::get_camera() const {
+  return Camera::look_along(view.position, view.front);
+}
+
+const KartPhysics& Simulation::get_karts() const {
+  return karts;
+}
+
+uint64_t Simulation::get_tick() const {
+  return tick;
+}
+
+uint64_t Simulation::checksum() const {
+  uint64_t hash = Checksum::add(Checksum::SEED, tick);
+  hash = karts.checksum(hash);
+  hash = Checksum::add(hash, view);
+  return Checksum::add(hash, prev_view);
+}
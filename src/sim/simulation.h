@@ -0,0 +1,51 @@
+#pragma once
+#include "sim/input.h"
+#include "sim/kart_physics.h"
+#include "sim/snapshot.h"
+#include "sim/track_map.h"
+#include "render/camera.h"
+
+#include <cstdint>
+#include <vector>
+
+// Game state advanced in fixed ticks. Has no dependency on GLFW or GL so it
+// can be stepped headless as fast as the CPU allows.
+//
+// The player drives kart 0; the camera chases it.
+//
+// Stepping is deterministic: the same input stream gives bit-identical
+// state on every run and every conforming compiler. Nothing in step()
+// calls libm beyond sqrt, which IEEE 754 rounds exactly, and the sim is
+// built without floating point contraction (see CMakeLists.txt). Camera
+// angles are only worked out when a Camera is handed to the renderer.
+class Simulation {
+  KartPhysics karts;
+  const TrackMap* track;
+  JobSystem* jobs;
+  View view;
+  View prev_view;
+  // Kart positions before the last step, for snapshots.
+  std::vector<float> prev_x;
+  std::vector<float> prev_z;
+  uint64_t tick;
+
+  void update_view();
+  public:
+    static constexpr float TICK_SECONDS = 1.f / 60.f;
+    static constexpr size_t PLAYER_KART = 0;
+
+    Simulation();
+    // Surfaces and walls come from track; without one the world is open road.
+    void set_track(const TrackMap* track);
+    // Lets physics spread large fields of karts over worker threads.
+    void set_job_system(JobSystem* jobs);
+    void step(const Input& input);
+    // Copies what the renderer needs into out, reusing its storage. time
+    // is when the tick just run ended, for the renderer to interpolate by.
+    void write_snapshot(Snapshot& out, double time) const;
+    Camera get_camera() const;
+    const KartPhysics& get_karts() const;
+    uint64_t get_tick() const;
+    // Hash of the whole simulation state after the last step().
+    uint64_t checksum() const;
+};
@@ -0,0 +1,62 @@
+#include "simulation_thread.h"
+#include "sim/timestep.h"
+#include "profiler/profiler.h"
+
+#include <chrono>
+
+SimulationThread::SimulationThread(Simulation& sim, InputQueue& input, InputRecording* recording) :
+                                   sim{sim},
+                                   input{input},
+                                   recording{recording},
+                                   running{false} {
+  // Give the render thread something to draw before the first tick.
+  sim.write_snapshot(snapshots.write_buffer(), InputQueue::now());
+  snapshots.publish();
+}
+
+SimulationThread::~SimulationThread() {
+  stop();
+}
+
+void SimulationThread::start() {
+  if (running.exchange(true))
+    return;
+  thread = std::thread{&SimulationThread::run, this};
+}
+
+void SimulationThread::stop() {
+  running.store(false);
+  if (thread.joinable())
+    thread.join();
+}
+
+const Snapshot& SimulationThread::latest_snapshot() {
+  snapshots.update();
+  return snapshots.read_buffer();
+}
+
+void SimulationThread::run() {
+  Profiler::set_thread_name("simulation");
+  FixedTimestep timestep{Simulation::TICK_SECONDS};
+  const double step = timestep.get_step();
+  double t_prev = InputQueue::now();
+  while (running.load(std::memory_order_relaxed)) {
+    double t_now = InputQueue::now();
+    int num_ticks = timestep.advance(t_now - t_prev);
+    t_prev = t_now;
+    // The ticks run now cover simulated time up to t_now minus what is
+    // left in the accumulator; each takes the keys held at its end.
+    double tick_end = t_now - timestep.alpha() * step - (num_ticks - 1) * step;
+    for (int i = 0; i < num_ticks; i++) {
+      Input in = input.input_at(tick_end + i * step);
+      if (recording)
+        recording->record(in);
+      sim.step(in);
+      sim.write_snapshot(snapshots.write_buffer(), tick_end + i * step);
+      snapshots.publish();
+    }
+    // Sleep until the next tick is due rather than spinning on a core the
+    // render thread could use.
+    std::this_thread::sleep_for(std::chrono::duration<double>((1.0 - timestep.alpha()) * step));
+  }
+}
@@ -0,0 +1,41 @@
+#pragma once
+#include "sim/input_queue.h"
+#include "sim/input_recording.h"
+#include "sim/simulation.h"
+#include "sim/snapshot.h"
+#include "sim/triple_buffer.h"
+
+#include <atomic>
+#include <thread>
+
+// Runs a Simulation on its own thread in real time, so ticks overlap with
+// the render thread drawing and submitting the previous ones. Input comes
+// in through an InputQueue and each tick goes out as a Snapshot; the
+// render thread never touches the Simulation itself while it runs.
+class SimulationThread {
+  private:
+    Simulation& sim;
+    InputQueue& input;
+    InputRecording* recording;
+    TripleBuffer<Snapshot> snapshots;
+    std::atomic<bool> running;
+    std::thread thread;
+
+    void run();
+
+  public:
+    // Ticks are recorded into recording, if given.
+    SimulationThread(Simulation& sim, InputQueue& input, InputRecording* recording = nullptr);
+    ~SimulationThread();
+    SimulationThread(const SimulationThread&) = delete;
+    SimulationThread& operator=(const SimulationThread&) = delete;
+
+    void start();
+    // Waits for the tick in progress to finish. The Simulation and the
+    // recording are safe to read again once this returns.
+    void stop();
+
+    // Render thread only. Picks up the newest published tick, if there is
+    // one, and returns the latest; valid until the next call.
+    const Snapshot& latest_snapshot();
+};
@@ -0,0 +1,10 @@
+#include "snapshot.h"
+#include "glm/common.hpp"
+
+Camera Snapshot::interpolated_camera(float alpha) const {
+  glm::vec3 position = glm::mix(prev_view.position, view.position, alpha);
+  // Headings turn far less than 180 degrees a tick, so blending the vectors
+  // and renormalizing always takes the short way round.
+  glm::vec3 front = glm::mix(prev_view.front, view.front, alpha);
+  return Camera::look_along(position, front);
+}
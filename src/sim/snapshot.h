@@ -0,0 +1,34 @@
+#pragma once
+#include "render/camera.h"
+#include "glm/vec3.hpp"
+
+#include <cstdint>
+#include <vector>
+
+// Chase camera as the simulation sees it: a point and a unit heading.
+struct View {
+  glm::vec3 position;
+  glm::vec3 front;
+};
+
+// Everything the renderer needs from one simulation tick, copied out so it
+// can be drawn while the simulation is already working on the next tick.
+// The previous tick's poses come along so the renderer can interpolate
+// without reaching back into the simulation.
+struct Snapshot {
+  uint64_t tick = 0;
+  // When the tick ended, on the clock the simulation schedules ticks by.
+  double time = 0.0;
+  View prev_view{};
+  View view{};
+  // One entry per kart.
+  std::vector<float> prev_x;
+  std::vector<float> prev_z;
+  std::vector<float> x;
+  std::vector<float> z;
+  std::vector<float> dir_x;
+  std::vector<float> dir_z;
+
+  // Camera blended between the previous and this tick, alpha in [0, 1].
+  Camera interpolated_camera(float alpha) const;
+};
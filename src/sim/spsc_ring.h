@@ -0,0 +1,65 @@
+#pragma once
+#include <array>
+#include <atomic>
+#include <cstddef>
+
+// Fixed-size ring for handing items from exactly one producer thread to
+// exactly one consumer thread without locks. Each side owns one index and
+// only reads the other's; each also keeps a cached copy of the other's
+// index and re-reads the shared one only when the cache says the ring is
+// full (producer) or empty (consumer), so in steady state neither side
+// touches the other's cache line.
+template<typename T, size_t CAPACITY>
+class SpscRing {
+  static_assert(CAPACITY > 0 && (CAPACITY & (CAPACITY - 1)) == 0, "CAPACITY must be a power of two");
+  static constexpr size_t CACHE_LINE = 64;
+
+  // Next slot to write; written by the producer only.
+  alignas(CACHE_LINE) std::atomic<size_t> head{0};
+  size_t cached_tail = 0;
+  // Next slot to read; written by the consumer only.
+  alignas(CACHE_LINE) std::atomic<size_t> tail{0};
+  size_t cached_head = 0;
+  alignas(CACHE_LINE) std::array<T, CAPACITY> items{};
+
+  public:
+    // Producer only. Returns false, dropping item, if the ring is full.
+    bool push(const T& item) {
+      size_t h = head.load(std::memory_order_relaxed);
+      if (h - cached_tail == CAPACITY) {
+        cached_tail = tail.load(std::memory_order_acquire);
+        if (h - cached_tail == CAPACITY)
+          return false;
+      }
+      items[h & (CAPACITY - 1)] = item;
+      head.store(h + 1, std::memory_order_release);
+      return true;
+    }
+
+    // Consumer only. The oldest item, or nullptr if the ring is empty. The
+    // item stays valid until pop().
+    const T* peek() {
+      size_t t = tail.load(std::memory_order_relaxed);
+      if (t == cached_head) {
+        cached_head = head.load(std::memory_order_acquire);
+        if (t == cached_head)
+          return nullptr;
+      }
+      return &items[t & (CAPACITY - 1)];
+    }
+
+    // Consumer only. Discards the item returned by peek().
+    void pop() {
+      tail.store(tail.load(std::memory_order_relaxed) + 1, std::memory_order_release);
+    }
+
+    // Consumer only.
+    bool pop(T& item) {
+      const T* next = peek();
+      if (!next)
+        return false;
+      item = *next;
+      pop();
+      return true;
+    }
+};
@@ -0,0 +1,28 @@
+#include "timestep.h"
+
+FixedTimestep::FixedTimestep(double step, int max_steps_per_frame) :
+                             step{step},
+                             accumulator{0.0},
+                             max_steps_per_frame{max_steps_per_frame} {
+}
+
+int FixedTimestep::advance(double elapsed) {
+  accumulator += elapsed;
+  int steps = (int)(accumulator / step);
+  // Don't let a long stall (debugger, window drag) turn into a spiral of
+  // catch-up ticks; drop the excess time instead.
+  if (steps > max_steps_per_frame) {
+    steps = max_steps_per_frame;
+    accumulator = steps * step;
+  }
+  accumulator -= steps * step;
+  return steps;
+}
+
+float FixedTimestep::alpha() const {
+  return (float)(accumulator / step);
+}
+
+double FixedTimestep::get_step() const {
+  return step;
+}
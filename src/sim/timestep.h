@@ -0,0 +1,16 @@
+#pragma once
+
+// Accumulates variable wall-clock frame time and hands it out as a whole
+// number of fixed simulation ticks. Whatever is left over is exposed as
+// alpha() so the renderer can interpolate between the last two sim states.
+class FixedTimestep {
+  double step;
+  double accumulator;
+  int max_steps_per_frame;
+  public:
+    FixedTimestep(double step, int max_steps_per_frame = 8);
+    // Adds elapsed seconds and returns how many ticks should run now.
+    int advance(double elapsed);
+    float alpha() const;
+    double get_step() const;
+};
@@ -0,0 +1,276 @@
+#include "track_map.h"
+#include "stb_image/stb_image.h"
+
+#include <algorithm>
+#include <cstdlib>
+#include <cstring>
+#include <fstream>
+#include <iostream>
+#include <iterator>
+#include <sstream>
+
+namespace {
+  uint32_t read_be32(const unsigned char* p) {
+    return (uint32_t)p[0] << 24 | (uint32_t)p[1] << 16 | (uint32_t)p[2] << 8 | (uint32_t)p[3];
+  }
+
+  int paeth(int a, int b, int c) {
+    int p = a + b - c;
+    int pa = std::abs(p - a);
+    int pb = std::abs(p - b);
+    int pc = std::abs(p - c);
+    if (pa <= pb && pa <= pc)
+      return a;
+    return pb <= pc ? b : c;
+  }
+
+  // Just enough PNG to get at palette indices, which stb_image always
+  // expands to colours: 8-bit, colour type 3, not interlaced. The zlib
+  // stream is inflated with stb_image's decoder.
+  bool decode_indexed_png(const std::vector<unsigned char>& file, int& width, int& height,
+                          std::vector<uint8_t>& indices, std::array<uint32_t, 256>& palette,
+                          std::string& error) {
+    static const unsigned char signature[8] = {137, 'P', 'N', 'G', '\r', '\n', 26, '\n'};
+    if (file.size() < 8 || std::memcmp(file.data(), signature, 8) != 0) {
+      error = "not a PNG file";
+      return false;
+    }
+    std::vector<unsigned char> compressed;
+    bool have_header = false;
+    palette.fill(0xff000000);
+    size_t pos = 8;
+    while (pos + 12 <= file.size()) {
+      uint32_t length = read_be32(&file[pos]);
+      const unsigned char* type = &file[pos + 4];
+      const unsigned char* data = &file[pos + 8];
+      if (length > file.size() - pos - 12) {
+        error = "truncated chunk";
+        return false;
+      }
+      if (std::memcmp(type, "IHDR", 4) == 0 && length >= 13) {
+        width = (int)read_be32(data);
+        height = (int)read_be32(data + 4);
+        if (data[8] != 8 || data[9] != 3 || data[12] != 0) {
+          error = "not an 8-bit, non-interlaced, indexed image";
+          return false;
+        }
+        have_header = true;
+      } else if (std::memcmp(type, "PLTE", 4) == 0) {
+        for (uint32_t i = 0; i < length / 3 && i < 256; i++)
+          palette[i] = 0xff000000 | data[i * 3] | data[i * 3 + 1] << 8 | data[i * 3 + 2] << 16;
+      } else if (std::memcmp(type, "IDAT", 4) == 0) {
+        compressed.insert(compressed.end(), data, data + length);
+      } else if (std::memcmp(type, "IEND", 4) == 0) {
+        break;
+      }
+      pos += 12 + length;
+    }
+    if (!have_header || width <= 0 || height <= 0) {
+      error = "missing IHDR";
+      return false;
+    }
+
+    size_t stride = (size_t)width + 1;
+    int raw_size = 0;
+    char* raw = stbi_zlib_decode_malloc_guesssize((const char*)compressed.data(), (int)compressed.size(),
+                                                  (int)(stride * height), &raw_size);
+    if (!raw || (size_t)raw_size < stride * height) {
+      std::free(raw);
+      error = "bad image data";
+      return false;
+    }
+
+    // Undo the per-row filters. With one byte per pixel the left
+    // neighbour is simply the previous byte.
+    indices.assign((size_t)width * height, 0);
+    const unsigned char* in = (const unsigned char*)raw;
+    for (int y = 0; y < height; y++) {
+      unsigned char filter = in[y * stride];
+      const unsigned char* src = in + y * stride + 1;
+      uint8_t* dst = indices.data() + (size_t)y * width;
+      const uint8_t* above = y > 0 ? dst - width : nullptr;
+      for (int x = 0; x < width; x++) {
+        int a = x > 0 ? dst[x - 1] : 0;
+        int b = above ? above[x] : 0;
+        int c = above && x > 0 ? above[x - 1] : 0;
+        int predictor = 0;
+        switch (filter) {
+          case 0: predictor = 0; break;
+          case 1: predictor = a; break;
+          case 2: predictor = b; break;
+          case 3: predictor = (a + b) / 2; break;
+          case 4: predictor = paeth(a, b, c); break;
+          default:
+            std::free(raw);
+            error = "bad row filter";
+            return false;
+        }
+        dst[x] = (uint8_t)(src[x] + predictor);
+      }
+    }
+    std::free(raw);
+    return true;
+  }
+}
+
+const char* surface_name(Surface surface) {
+  switch (surface) {
+    case Surface::ROAD: return "road";
+    case Surface::GRASS: return "grass";
+    case Surface::OFF_TRACK: return "off-track";
+    case Surface::WALL: return "wall";
+    case Surface::BOOST: return "boost";
+    default: return "unknown";
+  }
+}
+
+Surface surface_from_name(const std::string& name) {
+  for (int i = 0; i < (int)Surface::COUNT; i++) {
+    if (name == surface_name((Surface)i))
+      return (Surface)i;
+  }
+  return Surface::COUNT;
+}
+
+TrackMap::TrackMap() :
+                   width{0},
+                   height{0},
+                   palette{},
+                   surfaces{},
+                   center_x{0.0f},
+                   center_z{-0.3f},
+                   size{1.0f},
+                   min_x{0.0f},
+                   max_z{0.0f},
+                   texels_per_unit_x{0.0f},
+                   texels_per_unit_z{0.0f} {
+  // The defaults match SoftRenderer::GroundPlane and the course quad.
+  surfaces.fill(Surface::WALL);
+  update_mapping();
+}
+
+bool TrackMap::load(const std::string& filename) {
+  std::ifstream in(filename, std::ios::binary);
+  std::vector<unsigned char> file{std::istreambuf_iterator<char>(in), std::istreambuf_iterator<char>()};
+  std::string error = "can't read file";
+  if (in.is_open() && decode_indexed_png(file, width, height, indices, palette, error)) {
+    for (int i = 0; i < 256; i++)
+      surfaces[i] = classify_color(palette[i]);
+    update_mapping();
+    return true;
+  }
+  std::cout << "Failed to load track map " << filename << ": " << error << "\n";
+  width = 0;
+  height = 0;
+  indices.clear();
+  update_mapping();
+  return false;
+}
+
+void TrackMap::set_bounds(float center_x, float center_z, float size) {
+  this->center_x = center_x;
+  this->center_z = center_z;
+  this->size = size;
+  update_mapping();
+}
+
+void TrackMap::update_mapping() {
+  min_x = center_x - size * 0.5f;
+  max_z = center_z + size * 0.5f;
+  texels_per_unit_x = width / size;
+  texels_per_unit_z = height / size;
+}
+
+void TrackMap::set_surface(uint8_t index, Surface surface) {
+  surfaces[index] = surface;
+}
+
+bool TrackMap::load_surfaces(const std::string& filename) {
+  std::ifstream in(filename);
+  if (!in.is_open()) {
+    std::cout << "Failed to open " << filename << "\n";
+    return false;
+  }
+  std::string line;
+  int line_number = 0;
+  while (std::getline(in, line)) {
+    line_number++;
+    line = line.substr(0, line.find('#'));
+    std::istringstream fields(line);
+    int index;
+    std::string name;
+    if (!(fields >> index))
+      continue;
+    fields >> name;
+    Surface surface = surface_from_name(name);
+    if (index < 0 || index > 255 || surface == Surface::COUNT) {
+      std::cout << filename << ":" << line_number << ": expected \"index surface\"\n";
+      return false;
+    }
+    set_surface((uint8_t)index, surface);
+  }
+  return true;
+}
+
+Surface TrackMap::surface_at(float x, float z) const {
+  Surface out;
+  surfaces_at(&x, &z, 1, &out);
+  return out;
+}
+
+void TrackMap::surfaces_at(const float* xs, const float* zs, size_t count, Surface* out) const {
+  if (indices.empty()) {
+    std::fill(out, out + count, Surface::WALL);
+    return;
+  }
+  // No branches in the loop: positions off the map read texel 0 and then
+  // have the result replaced, so lookups for different karts overlap.
+  const float w = (float)width;
+  const float h = (float)height;
+  const uint8_t* grid = indices.data();
+  for (size_t i = 0; i < count; i++) {
+    float u = (xs[i] - min_x) * texels_per_unit_x;
+    float v = (max_z - zs[i]) * texels_per_unit_z;
+    bool inside = u >= 0.0f && v >= 0.0f && u < w && v < h;
+    size_t texel = inside ? (size_t)v * width + (size_t)u : 0;
+    out[i] = inside ? surfaces[grid[texel]] : Surface::WALL;
+  }
+}
+
+uint8_t TrackMap::index_at_texel(int x, int y) const {
+  return indices[(size_t)y * width + x];
+}
+
+int TrackMap::get_width() const {
+  return width;
+}
+
+int TrackMap::get_height() const {
+  return height;
+}
+
+uint32_t TrackMap::get_color(uint8_t index) const {
+  return palette[index];
+}
+
+Surface TrackMap::get_surface(uint8_t index) const {
+  return surfaces[index];
+}
+
+Surface TrackMap::classify_color(uint32_t rgba) {
+  int r = rgba & 0xff;
+  int g = (rgba >> 8) & 0xff;
+  int b = (rgba >> 16) & 0xff;
+  int high = std::max({r, g, b});
+  int low = std::min({r, g, b});
+  // Asphalt, lane markings, the start line and kerbs' white stripes.
+  if (high - low <= 16)
+    return Surface::ROAD;
+  // Sand and dirt: warm, muted, red >= green > blue.
+  if (r >= g && g > b && high - low <= 112 && r - b >= 32)
+    return Surface::OFF_TRACK;
+  // The infield lawn.
+  if (g > r && g > b && g <= 176)
+    return Surface::GRASS;
+  return Surface::WALL;
+}
@@ -0,0 +1,81 @@
+#pragma once
+#include <array>
+#include <cstddef>
+#include <cstdint>
+#include <string>
+#include <vector>
+
+// What a kart is driving on. Physics reads this, never the GPU texture.
+enum class Surface : uint8_t {
+  ROAD,
+  // Slows karts a little.
+  GRASS,
+  // Sand and dirt beside the road; slows karts a lot.
+  OFF_TRACK,
+  // Blocks karts; also everything outside the map.
+  WALL,
+  BOOST,
+  COUNT
+};
+
+const char* surface_name(Surface surface);
+// Surface::COUNT if name is not a surface.
+Surface surface_from_name(const std::string& name);
+
+// Surface types for the course, read from the palette indices of the
+// course image. The image is 8-bit indexed, so the map keeps one byte per
+// texel (1 MiB for a 1024x1024 course, a quarter of the RGBA texture) and a
+// 256-entry table turns an index into a Surface. World coordinates map onto
+// the image the same way the course quad is textured: the square of side
+// size centred on (center_x, center_z) in the xz plane, with texel row 0 at
+// the far (largest z) edge.
+class TrackMap {
+  int width;
+  int height;
+  std::vector<uint8_t> indices;
+  // RGBA8, red in the lowest byte.
+  std::array<uint32_t, 256> palette;
+  std::array<Surface, 256> surfaces;
+  float center_x;
+  float center_z;
+  float size;
+  // Derived from the bounds and the image size.
+  float min_x;
+  float max_z;
+  float texels_per_unit_x;
+  float texels_per_unit_z;
+
+  void update_mapping();
+
+  public:
+    TrackMap();
+
+    // Reads an 8-bit indexed PNG and classifies its palette with
+    // classify_color(). Prints the reason and returns false otherwise.
+    bool load(const std::string& filename);
+    // Where the map lies in the world; defaults to the course quad.
+    void set_bounds(float center_x, float center_z, float size);
+    // Overrides the classification of one palette entry.
+    void set_surface(uint8_t index, Surface surface);
+    // Reads "index surface" lines (# starts a comment) and applies them
+    // with set_surface(). Returns false if the file can't be read or a
+    // line is malformed; lines before the bad one still apply.
+    bool load_surfaces(const std::string& filename);
+
+    Surface surface_at(float x, float z) const;
+    // surface_at for count positions at once, e.g. every kart in a tick.
+    // Positions are structure-of-arrays so the caller's kart data can be
+    // passed without repacking.
+    void surfaces_at(const float* xs, const float* zs, size_t count, Surface* out) const;
+    // Palette index at a texel, for debugging and tools.
+    uint8_t index_at_texel(int x, int y) const;
+
+    int get_width() const;
+    int get_height() const;
+    uint32_t get_color(uint8_t index) const;
+    Surface get_surface(uint8_t index) const;
+
+    // Guesses a surface from a palette colour: greys and white are road,
+    // browns off-track, dark greens grass, saturated colours wall blocks.
+    static Surface classify_color(uint32_t rgba);
+};
@@ -0,0 +1,53 @@
+#pragma once
+#include <array>
+#include <atomic>
+#include <cstdint>
+
+// Hands the latest value from one writer thread to one reader thread
+// without either ever waiting. The writer fills its own slot and publishes
+// it by swapping it with the shared middle slot; the reader swaps the
+// middle slot for its own whenever something new has been published. Values
+// the reader never got round to are simply overwritten, so a slow reader
+// always sees the newest one and a slow writer leaves the reader on the
+// last one it published.
+//
+// Slots are reused rather than reallocated, so a T holding vectors keeps
+// their capacity from one publish to the next.
+template<typename T>
+class TripleBuffer {
+  // Set on middle while it holds a value the reader hasn't taken yet.
+  static constexpr uint8_t FRESH = 4;
+  static constexpr uint8_t INDEX = 3;
+
+  std::array<T, 3> slots{};
+  std::atomic<uint8_t> middle{1};
+  // Owned by the writer.
+  uint8_t back = 0;
+  // Owned by the reader.
+  uint8_t front = 2;
+
+  public:
+    // Writer only. The slot to fill before publish().
+    T& write_buffer() {
+      return slots[back];
+    }
+
+    // Writer only.
+    void publish() {
+      back = middle.exchange(back | FRESH, std::memory_order_acq_rel) & INDEX;
+    }
+
+    // Reader only. Takes the newest published value, if there is one since
+    // the last call, and returns whether read_buffer() changed.
+    bool update() {
+      if (!(middle.load(std::memory_order_relaxed) & FRESH))
+        return false;
+      front = middle.exchange(front, std::memory_order_acq_rel) & INDEX;
+      return true;
+    }
+
+    // Reader only. Valid until the next update().
+    const T& read_buffer() const {
+      return slots[front];
+    }
+};